@@ -0,0 +1,74 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __adjacency_h__
+#define __adjacency_h__
+
+#include <vector>
+#include "buffer.h"
+#include "matrix.h"
+
+// Arc as read from the instance, before the adjacency is built
+struct Arc {
+	unsigned int from;
+	unsigned int to;
+	double cost;
+	unsigned int reward;
+};
+
+// Outgoing arc of a vertex. Cost and reward sit next to the target so a
+// lookup touches a single cache line.
+struct Neighbor {
+	unsigned int to;
+	unsigned int reward;
+	double cost;
+};
+
+// Compressed-sparse-row adjacency. Neighbors of each vertex are sorted by
+// target, lookups binary search them or, for small graphs, go through a
+// dense V x V table of arc indices. Arcs are fixed once built, only their
+// cost and reward may change.
+class Adjacency {
+private:
+	unsigned int _size;
+	Buffer<unsigned int> _offsets;
+	Buffer<Neighbor> _neighbors;
+	Matrix<unsigned int> _lookup;
+public:
+	Adjacency(unsigned int = 0);
+	Adjacency(unsigned int, std::vector<Arc> const &);
+	Adjacency(unsigned int, Buffer<unsigned int> &&, Buffer<Neighbor> &&,
+		  Matrix<unsigned int> &&);
+
+	unsigned int size(void) const;
+	unsigned int arcs(void) const;
+	unsigned int find(unsigned int, unsigned int) const;
+
+	Neighbor const &arc(unsigned int) const;
+	void set(unsigned int, double, unsigned int);
+	Adjacency reversed(void) const;
+	Neighbor const *begin(unsigned int) const;
+	Neighbor const *end(unsigned int) const;
+
+	Buffer<unsigned int> const &offsets(void) const;
+	Buffer<Neighbor> const &neighbors(void) const;
+	Matrix<unsigned int> const &lookup(void) const;
+
+	static unsigned int const dense_lookup_max;
+};
+
+#endif
@@ -0,0 +1,57 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __aligned_h__
+#define __aligned_h__
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Size of a cache line, rows that different threads write to are padded to it
+constexpr size_t CACHE_LINE = 64;
+
+// Allocator handing out cache line aligned memory
+template <typename T>
+struct AlignedAllocator {
+	typedef T value_type;
+
+	AlignedAllocator(void) = default;
+	template <typename U>
+	AlignedAllocator(AlignedAllocator<U> const &) {}
+
+	T *allocate(size_t n)
+	{
+		return static_cast<T *>(::operator new(n * sizeof(T),
+			std::align_val_t(CACHE_LINE)));
+	}
+
+	void deallocate(T *p, size_t)
+	{
+		::operator delete(p, std::align_val_t(CACHE_LINE));
+	}
+
+	template <typename U>
+	bool operator==(AlignedAllocator<U> const &) const { return true; }
+	template <typename U>
+	bool operator!=(AlignedAllocator<U> const &) const { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T> >;
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __batch_h__
+#define __batch_h__
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include "graph.h"
+#include "solver.h"
+
+// Solve many instances in one process on a single thread pool. source is
+// "-" for instances concatenated on the standard input, or the path of a
+// manifest listing one instance file per line. Results are printed in
+// input order. Instance k is solved with options seeded with seed + k and
+// a time limit counted from its own start. Returns the exit status.
+int batch(std::string const &, APSP, size_t, Options const &,
+	  std::chrono::milliseconds, unsigned int, bool);
+
+// Solve every query in a file on one analyzed graph. Each line holds S0
+// (one based), Cmin and Cmax. Queries share the graph's tables, starts
+// other than the graph's only reroot its MST. Query k is seeded with
+// seed + k, results are printed in file order. Returns the exit status.
+int queries(std::string const &, Graph &&, Options const &,
+	    std::chrono::milliseconds, unsigned int, bool);
+
+#endif
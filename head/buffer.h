@@ -0,0 +1,173 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __buffer_h__
+#define __buffer_h__
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Contiguous array of T that either owns its elements or is a read-only view
+// into memory kept alive by someone else (i.e. a mapped file). Views are
+// copied into owned storage the first time they are written to.
+template <typename T>
+class Buffer {
+private:
+	std::vector<T> _own;
+	std::shared_ptr<void const> _keep;
+	T *_ptr;
+	size_t _size;
+
+	void detach(void);
+public:
+	Buffer(size_t = 0, T const & = T());
+	Buffer(std::vector<T> &&);
+	Buffer(T const *, size_t, std::shared_ptr<void const>);
+	Buffer(Buffer const &);
+	Buffer(Buffer &&);
+	Buffer &operator=(Buffer const &);
+	Buffer &operator=(Buffer &&);
+
+	size_t size(void) const;
+	bool mapped(void) const;
+
+	T *data(void);
+	T const *data(void) const;
+	T &operator[](size_t);
+	T const &operator[](size_t) const;
+};
+
+/* */
+template <typename T>
+Buffer<T>::Buffer(size_t size, T const &value)
+	: _own(size, value)
+	, _keep()
+	, _ptr(_own.data())
+	, _size(size)
+{}
+
+template <typename T>
+Buffer<T>::Buffer(std::vector<T> &&v)
+	: _own(std::move(v))
+	, _keep()
+	, _ptr(_own.data())
+	, _size(_own.size())
+{}
+
+template <typename T>
+Buffer<T>::Buffer(T const *data, size_t size, std::shared_ptr<void const> keep)
+	: _own()
+	, _keep(std::move(keep))
+	, _ptr(const_cast<T *>(data))
+	, _size(size)
+{}
+
+template <typename T>
+Buffer<T>::Buffer(Buffer const &other)
+	: _own(other._own)
+	, _keep(other._keep)
+	, _ptr(other._keep ? other._ptr : _own.data())
+	, _size(other._size)
+{}
+
+template <typename T>
+Buffer<T>::Buffer(Buffer &&other)
+	: _own(std::move(other._own))
+	, _keep(std::move(other._keep))
+	, _ptr(other._ptr)
+	, _size(other._size)
+{
+	other._ptr = other._own.data();
+	other._size = 0;
+}
+
+template <typename T>
+Buffer<T> &Buffer<T>::operator=(Buffer const &other)
+{
+	if (this != &other)
+		*this = Buffer(other);
+	return *this;
+}
+
+template <typename T>
+Buffer<T> &Buffer<T>::operator=(Buffer &&other)
+{
+	if (this == &other)
+		return *this;
+
+	_own = std::move(other._own);
+	_keep = std::move(other._keep);
+	_ptr = other._ptr;
+	_size = other._size;
+
+	other._ptr = other._own.data();
+	other._size = 0;
+	return *this;
+}
+
+template <typename T>
+void Buffer<T>::detach(void)
+{
+	_own.assign(_ptr, _ptr + _size);
+	_keep.reset();
+	_ptr = _own.data();
+}
+
+template <typename T>
+size_t Buffer<T>::size(void) const
+{
+	return _size;
+}
+
+template <typename T>
+bool Buffer<T>::mapped(void) const
+{
+	return bool(_keep);
+}
+
+template <typename T>
+T *Buffer<T>::data(void)
+{
+	if (_keep)
+		detach();
+	return _ptr;
+}
+
+template <typename T>
+T const *Buffer<T>::data(void) const
+{
+	return _ptr;
+}
+
+template <typename T>
+T &Buffer<T>::operator[](size_t i)
+{
+	assert(i < _size);
+	return data()[i];
+}
+
+template <typename T>
+T const &Buffer<T>::operator[](size_t i) const
+{
+	assert(i < _size);
+	return _ptr[i];
+}
+
+#endif
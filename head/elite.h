@@ -0,0 +1,56 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __elite_h__
+#define __elite_h__
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "particle.h"
+
+// A route found by the search, with its cost and reward as the particles
+// see them (penalized cost)
+struct Solution {
+	std::vector<unsigned int> route;
+	double cost;
+	unsigned int reward;
+};
+
+// The best distinct feasible routes a run has come across, best first.
+// Offers may come from any thread, the pool is kept small so they are
+// cheap. Equally good routes are ordered by their vertices, so the pool
+// ends up the same whatever order the offers arrive in.
+class Elite {
+private:
+	size_t _capacity;
+	std::vector<Solution> _pool;
+	mutable std::mutex _m;
+public:
+	Elite(size_t);
+	Elite(Elite const &) = delete;
+	Elite &operator=(Elite const &) = delete;
+
+	bool offer(Particle const &);
+	std::vector<Solution> solutions(void) const;
+	std::vector<Solution> top(Particle const &, size_t) const;
+
+	static bool same(std::vector<unsigned int> const &,
+			 std::vector<unsigned int> const &);
+};
+
+#endif
@@ -0,0 +1,57 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __exchange_h__
+#define __exchange_h__
+
+#include <cstddef>
+#include <cstdint>
+#include "graph.h"
+#include "particle.h"
+
+// Best particles of several solver processes on the same machine. The slots
+// live in an anonymous shared mapping created before forking, one per
+// process. Each slot has a single writer, its owner, and is read under a
+// seqlock, so nobody ever blocks. Routes travel along with the rows, and a
+// best whose route doesn't fit in arcs + 1 vertices isn't published.
+class Exchange {
+private:
+	size_t _slots;
+	size_t _size;
+	size_t _capacity;
+	size_t _stride;
+	void *_map;
+	size_t _bytes;
+	unsigned int _self;
+
+	unsigned char *_slot(size_t) const;
+public:
+	Exchange(unsigned int, Graph const &);
+	Exchange(Exchange const &) = delete;
+	Exchange &operator=(Exchange const &) = delete;
+	~Exchange(void);
+
+	unsigned int slots(void) const;
+	unsigned int self(void) const;
+	void self(unsigned int);
+
+	void publish(Particle const &);
+	bool fetch(unsigned int, Particle &) const;
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __fitness_cache_h__
+#define __fitness_cache_h__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "aligned.h"
+
+// What the evaluation of a route yields, before penalties
+struct Fitness {
+	double cost = 0;
+	unsigned int reward = 0;
+	bool double_use = false;
+};
+
+// Bounded table from visiting orders to their fitness, shared by every
+// particle of a run. Orders are keyed by two independent 64 bit hashes;
+// entries are spread over shards with a lock each and are direct mapped
+// inside them, so a newer order just takes the slot of an older one.
+class FitnessCache {
+public:
+	struct Key {
+		uint64_t h1 = 0;
+		uint64_t h2 = 0;
+
+		bool operator==(Key const &o) const
+		{
+			return h1 == o.h1 && h2 == o.h2;
+		}
+	};
+private:
+	struct Entry {
+		Key key;
+		Fitness fitness;
+
+		Entry(void) : key(), fitness() {}
+	};
+	struct alignas(CACHE_LINE) Shard {
+		mutable std::mutex lock;
+		std::vector<Entry> table;
+		uint64_t hits;
+		uint64_t misses;
+
+		Shard(void) : lock(), table(), hits(0), misses(0) {}
+	};
+	static constexpr size_t SHARDS = 64;
+
+	std::vector<Shard> _shards;
+	size_t _mask;
+	std::atomic<uint64_t> _repeats;
+
+	Shard &_shard(Key const &);
+	Shard const &_shard(Key const &) const;
+public:
+	FitnessCache(size_t);
+	FitnessCache(FitnessCache const &) = delete;
+	FitnessCache &operator=(FitnessCache const &) = delete;
+
+	bool find(Key const &, Fitness &);
+	void insert(Key const &, Fitness const &);
+	void repeat(void);
+
+	uint64_t hits(void) const;
+	uint64_t misses(void) const;
+	uint64_t repeats(void) const;
+
+	static Key key(std::vector<unsigned int> const &);
+};
+
+#endif
@@ -18,38 +18,82 @@
 #ifndef __graph_h__
 #define __graph_h__
 
-#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
+#include "adjacency.h"
 #include "edge.h"
 #include "gtree.h"
+#include "matrix.h"
+#include "path_cache.h"
+
+// All-pairs shortest paths engine: dense Floyd-Warshall tables or shortest
+// path trees computed on demand
+enum class APSP { Auto, Dense, Lazy };
+
+class ThreadPool;
 
 class Graph {
 private:
+	unsigned int _size;
 	unsigned int _start;
 
-	std::vector< std::unordered_map<unsigned int, Edge> > _costs_rewards;
-	std::vector< std::vector<double> > _min_costs;
-	std::vector< std::vector<unsigned int> > _max_rewards;
-	std::vector < std::vector<unsigned int> > _paths;
+	std::vector<Arc> _arcs;
+	Adjacency _adjacency;
+	Matrix<double> _min_costs;
+	Matrix<unsigned int> _max_rewards;
+	Matrix<unsigned int> _paths;
+	std::shared_ptr<PathCache> _lazy;
+	std::shared_ptr<PathTree const> _home;
 	std::vector<unsigned int> _blacklist;
+	std::vector< std::pair<unsigned int, unsigned int> > _mst_edges;
 	GTree _MST;
+	std::shared_ptr<char const> _roots; // held by graphs rooted from this
 
-	void make_floyd_warshall(void);
+	void make_floyd_warshall(unsigned int, ThreadPool *);
+	void make_lazy(size_t);
+	void make_blacklist(void);
 	void make_mst(void);
+	bool stuck(unsigned int) const;
+	void shorten_paths(unsigned int, unsigned int, double, unsigned int,
+			   ThreadPool *);
+	void lengthen_paths(unsigned int, unsigned int, double,
+			    Adjacency const &, ThreadPool *);
+	void update_blacklist(unsigned int);
+	bool update_mst(unsigned int, unsigned int, double);
+	PathTree const &path_tree(unsigned int) const;
 public:
 	Graph(unsigned int, unsigned int);
 
-	std::vector<unsigned int> &blacklist(void);
+	std::vector<unsigned int> const &blacklist(void) const;
 	void add_edge(unsigned int, unsigned int, double, unsigned int);
-	void analyze(bool);
-	std::vector<unsigned int> preorder(std::vector<double> const &, std::vector<bool> const &);
+	void add_edges(std::vector<Arc> &&);
+	void analyze(bool, unsigned int = 0, APSP = APSP::Auto,
+		     size_t = default_budget, ThreadPool * = NULL);
+	bool load(std::string const &, uint64_t, bool, APSP = APSP::Auto,
+		  size_t = default_budget);
+	void save(std::string const &, uint64_t) const;
+	size_t update(std::vector<Arc> const &, ThreadPool * = NULL);
+	void preorder(std::vector<unsigned int> &, double const *, double const *) const;
 
 	unsigned int size(void) const;
 	unsigned int start(void) const;
 	Edge edge(unsigned int, unsigned int) const;
+	Adjacency const &adjacency(void) const;
 	double min_cost(unsigned int, unsigned int) const;
 	unsigned int max_reward(unsigned int, unsigned int) const;
 	std::vector<unsigned int> best_path(unsigned int, unsigned int) const;
+	void append_path(std::vector<unsigned int> &, unsigned int, unsigned int) const;
+	bool lazy(void) const;
+
+	static size_t const default_budget;
+	static APSP choose(unsigned int, unsigned int, size_t);
+	static uint64_t cache_key(char const *, size_t);
+	static std::shared_ptr<Graph const> rooted(
+		std::shared_ptr<Graph const> const &, unsigned int);
 };
 
 #endif
@@ -18,18 +18,23 @@
 #ifndef __gtree_h__
 #define __gtree_h__
 
+#include <utility>
 #include <vector>
 
+// Rooted tree stored as flat arrays: each vertex's parent, and the children
+// of vertex v in _children[_offsets[v] .. _offsets[v + 1])
 class GTree {
 private:
-	unsigned int _id;
-	std::vector<GTree> _sons;
+	unsigned int _id; // root
+	std::vector<unsigned int> _parent;
+	std::vector<unsigned int> _offsets;
+	std::vector<unsigned int> _children;
 public:
 	GTree(unsigned int);
 
-	void add_edges(std::vector< std::pair<unsigned int, unsigned int> > &);
+	void add_edges(unsigned int, std::vector< std::pair<unsigned int, unsigned int> > const &);
 
-	void preorder(std::vector<unsigned int> &, std::vector<double> const &, std::vector<bool> const &) const;
+	void preorder(std::vector<unsigned int> &, double const *, double const *) const;
 };
 
 #endif
@@ -0,0 +1,46 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __incumbents_h__
+#define __incumbents_h__
+
+#include <chrono>
+#include <mutex>
+#include "particle.h"
+
+// Stream of improving incumbents, one JSON object per line written to a
+// file descriptor: milliseconds since start, cost, reward and route.
+// Offers may come from any thread, only those beating the last one written
+// are streamed.
+class Incumbents {
+private:
+	int _fd;
+	std::chrono::steady_clock::time_point _start;
+	std::mutex _m;
+	double _cost;
+	unsigned int _reward;
+	bool _any;
+public:
+	Incumbents(int, std::chrono::steady_clock::time_point);
+	Incumbents(Incumbents const &) = delete;
+	Incumbents &operator=(Incumbents const &) = delete;
+
+	void offer(Particle const &);
+};
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __instance_h__
+#define __instance_h__
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "adjacency.h"
+
+class ThreadPool;
+
+// Malformed instance text
+class ParseError : public std::runtime_error {
+private:
+	size_t _line;
+public:
+	ParseError(size_t, std::string const &);
+
+	size_t line(void) const;
+};
+
+// Whole input, memory-mapped when it is a regular file and read in large
+// blocks otherwise (pipes, terminals)
+class Input {
+private:
+	std::string _own;
+	std::shared_ptr<void const> _keep;
+	char const *_data;
+	size_t _size;
+public:
+	Input(int);
+	Input(Input const &) = delete;
+	Input &operator=(Input const &) = delete;
+
+	char const *begin(void) const;
+	char const *end(void) const;
+	size_t line(char const *) const;
+};
+
+// Instance header and where its parts sit in the input
+struct Instance {
+	double Cmin;
+	double Cmax;
+	unsigned int V;
+	unsigned int E;
+	unsigned int S0; // zero based
+
+	char const *graph; // from V onwards, what defines the graph
+	char const *arcs; // first arc line
+	char const *end; // past the last arc line
+
+	Instance(void);
+};
+
+// One solve asked of an already analyzed graph
+struct Query {
+	unsigned int S0; // zero based
+	double Cmin;
+	double Cmax;
+};
+
+char const *parse_header(Input const &, char const *, Instance &);
+std::vector<Arc> parse_arcs(Input const &, Instance const &, unsigned int = 0,
+			    ThreadPool * = NULL);
+std::vector<Query> parse_queries(Input const &, unsigned int);
+std::vector< std::vector<unsigned int> > parse_routes(Input const &);
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __local_search_h__
+#define __local_search_h__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+#include "graph.h"
+
+// Local search settings: the final pass polishes the best route and the
+// best personal bests of the swarm, top of them in all. Memetic runs also
+// polish the elite personal bests after every iteration.
+struct Polish {
+	unsigned int top; // 0 disables the final pass
+	unsigned int moves; // moves applied per route, 0 means no limit
+	unsigned int elite; // 0 disables the memetic passes
+	unsigned int elite_moves;
+};
+
+// First-improvement local search over a closed route that uses every
+// undirected arc at most once. Moves are vertex insertion, removal and
+// swap, joined to the route along shortest paths, and 2-opt segment
+// reversal. Each is scored in O(1) from the shortest path tables and
+// prefix sums over the route; only moves that look improving are expanded
+// and checked exactly. Routes are ranked by cost outside [Cmin, Cmax]
+// first, then by reward, then by cost.
+class LocalSearch {
+private:
+	Graph const &_graph;
+	double _Cmin;
+	double _Cmax;
+
+	std::vector<unsigned int> _route;
+	std::unordered_set<uint64_t> _arcs;
+	double _cost;
+	unsigned int _reward;
+
+	// Prefix sums over the route arcs, forwards and reversed
+	std::vector<double> _fcost;
+	std::vector<double> _bcost;
+	std::vector<long> _freward;
+	std::vector<long> _breward;
+	std::vector<unsigned int> _missing;
+
+	// Candidate segment and the arcs it swaps
+	std::vector<unsigned int> _segment;
+	std::vector<uint64_t> _removed;
+	std::vector<uint64_t> _added;
+
+	void _index(void);
+	bool _fits(uint64_t const *, size_t, uint64_t const *, size_t) const;
+	bool _improves(double, unsigned int) const;
+	bool _splice(size_t, size_t, double, long);
+	bool _insert(void);
+	bool _remove(void);
+	bool _swap(void);
+	bool _two_opt(void);
+public:
+	LocalSearch(Graph const &, double, double);
+
+	bool load(std::vector<unsigned int> const &);
+	size_t run(size_t = 0);
+
+	std::vector<unsigned int> const &route(void) const;
+	double cost(void) const;
+	unsigned int reward(void) const;
+	double violation(void) const;
+	bool better(LocalSearch const &) const;
+};
+
+#endif
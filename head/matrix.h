@@ -0,0 +1,112 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __matrix_h__
+#define __matrix_h__
+
+#include <cassert>
+#include <cstddef>
+#include "buffer.h"
+
+// Dense row-major matrix stored in a single buffer. Bounds are only checked
+// by assertions, so release builds (NDEBUG) access memory directly. The
+// buffer may be a view into a mapped file, see Buffer.
+template <typename T>
+class Matrix {
+private:
+	size_t _rows;
+	size_t _cols;
+	Buffer<T> _data;
+public:
+	Matrix(size_t = 0, size_t = 0, T const & = T());
+	Matrix(size_t, size_t, Buffer<T> &&);
+
+	size_t rows(void) const;
+	size_t cols(void) const;
+
+	T &operator()(size_t, size_t);
+	T const &operator()(size_t, size_t) const;
+
+	T *row(size_t);
+	T const *row(size_t) const;
+	Buffer<T> const &buffer(void) const;
+};
+
+/* */
+template <typename T>
+Matrix<T>::Matrix(size_t rows, size_t cols, T const &value)
+	: _rows(rows)
+	, _cols(cols)
+	, _data(rows * cols, value)
+{}
+
+template <typename T>
+Matrix<T>::Matrix(size_t rows, size_t cols, Buffer<T> &&data)
+	: _rows(rows)
+	, _cols(cols)
+	, _data(std::move(data))
+{
+	assert(_data.size() == rows * cols);
+}
+
+template <typename T>
+size_t Matrix<T>::rows(void) const
+{
+	return _rows;
+}
+
+template <typename T>
+size_t Matrix<T>::cols(void) const
+{
+	return _cols;
+}
+
+template <typename T>
+T &Matrix<T>::operator()(size_t i, size_t j)
+{
+	assert(i < _rows && j < _cols);
+	return _data[i * _cols + j];
+}
+
+template <typename T>
+T const &Matrix<T>::operator()(size_t i, size_t j) const
+{
+	assert(i < _rows && j < _cols);
+	return _data[i * _cols + j];
+}
+
+template <typename T>
+T *Matrix<T>::row(size_t i)
+{
+	assert(i < _rows);
+	return _data.data() + i * _cols;
+}
+
+template <typename T>
+T const *Matrix<T>::row(size_t i) const
+{
+	assert(i < _rows);
+	return _data.data() + i * _cols;
+}
+
+template <typename T>
+Buffer<T> const &Matrix<T>::buffer(void) const
+{
+	return _data;
+}
+
+#endif
@@ -18,57 +18,102 @@
 #ifndef __particle_h__
 #define __particle_h__
 
+#include <cstddef>
+#include <memory>
 #include <vector>
+#include "aligned.h"
+#include "fitness_cache.h"
 #include "graph.h"
+#include "random.h"
+
+class Swarm;
+
+// How the particles of one run are evaluated: the budget, the penalty for
+// leaving it, the decoder and the fitness cache they share. Runs with
+// different settings may go on at the same time.
+struct Evaluation {
+	double Cmin;
+	double Cmax;
+	double penalty;
+	bool use_mst;
+	std::unique_ptr<FitnessCache> cache;
+
+	Evaluation(double, double, bool = false, size_t = 0);
+
+	bool feasible(double) const;
+	bool better(double, unsigned int, double, unsigned int) const;
+};
 
 class Particle {
 private:
-	Graph &_graph;
+	Graph const *_graph;
+	std::shared_ptr<Evaluation const> _evaluation;
 
 	unsigned int _times_no_improve;
 	double _cost;
 	unsigned int _reward;
 	double _best_cost;
 	unsigned int _best_reward;
+	Random _rng;
 
-	std::vector<double> _priorities;
-	std::vector<bool> _visiting;
+	// Rows of the swarm storage, or of _own for particles living outside
+	// a swarm. Visiting flags are stored as 0 or 1.
+	AlignedVector<double> _own;
+	double *_priorities;
+	double *_visiting;
+	double *_priorities_speed;
+	double *_visiting_speed;
+	double *_best_priorities;
+	double *_best_visiting;
 
-	std::vector<double> _priorities_speed;
-	std::vector<double> _visiting_speed;
+	// Route of the personal best, kept when it is found so that it is
+	// never decoded again. Local search may put a route here that the
+	// rows don't decode to exactly.
+	std::vector<unsigned int> _best_route;
 
-	std::vector<double> _best_priorities;
-	std::vector<bool> _best_visiting;
+	// Order and fitness of the last evaluation
+	FitnessCache::Key _last_key;
+	Fitness _last;
 
-	std::vector<unsigned int>_make_route(std::vector<double> const &, std::vector<bool> const &) const;
-
-	static double _penalty;
-	static double _Cmin;
-	static double _Cmax;
-	static bool _use_mst;
+	void _bind(double *);
+	void _make_route(std::vector<unsigned int> &, double const *, double const *) const;
+	void _order(std::vector<unsigned int> &, double const *, double const *) const;
+	void _build(std::vector<unsigned int> &, std::vector<unsigned int> &) const;
 public:
-	Particle(Graph &);
+	Particle(Graph const &, std::shared_ptr<Evaluation const> const &);
+	Particle(Graph const &, std::shared_ptr<Evaluation const> const &,
+		 double *, Random const &);
+	Particle(Particle const &);
 	Particle &operator=(Particle const &);
 
 	void randomize(void);
-	void eval(void);
-	void update_speed(Particle &, double, double);
-	void update_position(void);
-
+	bool eval(void);
+	void update(Particle const &, double, double, double);
+	void adopt(double, unsigned int, double const *, double const *,
+		   std::vector<unsigned int> const &);
+	void fix(std::vector<unsigned int> const &, double, unsigned int);
+	void encode(std::vector<unsigned int> const &, double, unsigned int);
+	void start_at(std::vector<unsigned int> const &, double, unsigned int);
+	void perturb(unsigned int);
 
+	Graph const &graph(void) const;
+	std::shared_ptr<Evaluation const> const &evaluation(void) const;
 	double cost(void) const;
 	double best_cost(void) const;
 	unsigned int reward(void) const;
 	unsigned int best_reward(void) const;
+	double const *best_priorities(void) const;
+	double const *best_visiting(void) const;
 	std::vector<unsigned int> route(void) const;
-	std::vector<unsigned int> best_route(void) const;
+	std::vector<unsigned int> const &best_route(void) const;
 
-	static void penalty(double);
-	static void Cmin(double);
-	static void Cmax(double);
-	static void use_mst(bool);
-	static Particle best(std::vector<Particle> &);
+	static bool better(Particle const &, Particle const &);
+	static size_t best(Swarm const &);
+	static size_t best(Swarm const &, size_t, size_t);
+
+	// Rows per particle and their padded length
+	static size_t const FIELDS = 6;
+	static size_t stride(size_t);
 };
 
 #endif
-
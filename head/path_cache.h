@@ -0,0 +1,74 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __path_cache_h__
+#define __path_cache_h__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "adjacency.h"
+
+// Shortest paths from every vertex towards a single root. This is one
+// column of the Floyd-Warshall tables: next[v] is the vertex that follows v
+// on its best path to the root (size() if the root can't be reached).
+struct PathTree {
+	std::vector<double> cost;
+	std::vector<unsigned int> reward;
+	std::vector<unsigned int> next;
+
+	PathTree(unsigned int);
+};
+
+// Lazily computed shortest path trees, kept in a bounded LRU cache. Trees
+// are built with Dijkstra over the reversed graph the first time a root is
+// asked for. Handed out trees stay valid after eviction, and after arcs
+// change. Each thread also keeps handles to the last few trees it looked
+// up, so that repeated lookups don't take the lock.
+class PathCache {
+private:
+	typedef std::shared_ptr<PathTree const> Tree;
+
+	Adjacency _reverse;
+	size_t _capacity;
+	std::atomic<uint64_t> _stamp; // unique to this cache and its arcs
+
+	std::list<unsigned int> _lru; // most recently used first
+	std::unordered_map< unsigned int,
+		std::pair<Tree, std::list<unsigned int>::iterator> > _trees;
+	std::mutex _m;
+
+	Tree build(unsigned int) const;
+public:
+	PathCache(Adjacency const &, size_t);
+	PathCache(PathCache const &) = delete;
+	PathCache &operator=(PathCache const &) = delete;
+
+	Tree tree(unsigned int);
+	PathTree const &local(unsigned int);
+	void update(unsigned int, unsigned int, double, unsigned int);
+	size_t capacity(void) const;
+
+	static size_t tree_bytes(unsigned int);
+};
+
+#endif
@@ -18,11 +18,60 @@
 #ifndef __pso_h__
 #define __pso_h__
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "elite.h"
 #include "graph.h"
+#include "local_search.h"
 #include "particle.h"
+#include "threadpool.h"
 
-Particle pso(Graph &, double, double, unsigned int, unsigned int, double,
-	     double, bool = false, bool = false, bool = false, unsigned int = 0,
-	     unsigned int = 0);
+class Exchange;
+class Incumbents;
+
+// Island model settings: the swarm is split in count sub-swarms, every
+// interval iterations each sends its best migrants to the next island
+// (ring) or to all of them. When remote is set, this process also trades
+// its best with the other processes sharing it.
+struct Islands {
+	unsigned int count;
+	unsigned int interval;
+	unsigned int migrants;
+	bool ring;
+	Exchange *remote;
+};
+
+// Everything a solve needs besides the budget. Defaults are those of the
+// command line.
+struct Options {
+	unsigned int max_cycles = 100;
+	unsigned int swarm_size = 100;
+	double social_factor = 0.7;
+	double cognitive_factor = 0.3;
+	double max_velocity = 0; // no limit
+	bool mst = false; // the graph must have been analyzed with its MST
+	bool random = false;
+	bool verbose = false;
+	unsigned int optima = 0;
+	uint64_t seed = 0;
+	bool async = false;
+	uint64_t evaluations = 0;
+	Islands islands = {1, 0, 0, true, NULL};
+	Polish polish = {0, 0, 0, 0};
+	std::chrono::steady_clock::time_point deadline =
+		std::chrono::steady_clock::time_point::max();
+	Incumbents *incumbents = NULL;
+	size_t fitness_cache = 0;
+	size_t top_k = 1;
+	std::vector< std::vector<unsigned int> > warm_start = {}; // zero based
+};
+
+Particle pso(Graph const &, double, double, Options const &, ThreadPool &,
+	     Elite * = NULL);
+
+void polish(Particle &, std::vector<Particle const *> const &, double, double,
+	    Polish const &, ThreadPool &);
 
 #endif
@@ -0,0 +1,44 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __random_h__
+#define __random_h__
+
+#include <cstddef>
+#include <cstdint>
+
+// xoshiro256** generator. Every particle owns one, seeded from the run seed
+// and its index in the swarm, so runs are reproducible whatever thread
+// happens to move each particle.
+class Random {
+private:
+	uint64_t _s[4];
+public:
+	typedef uint64_t result_type;
+
+	Random(uint64_t = 0, uint64_t = 0);
+
+	uint64_t operator()(void);
+	double uniform(void);
+	void uniform(double *, size_t);
+
+	static constexpr uint64_t min(void) { return 0; }
+	static constexpr uint64_t max(void) { return UINT64_MAX; }
+};
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __scratch_h__
+#define __scratch_h__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Set of undirected arcs, cleared in O(1) by bumping an epoch. Slots whose
+// stamp isn't the current epoch are free.
+class ArcSet {
+private:
+	std::vector<uint64_t> _keys;
+	std::vector<uint32_t> _stamps;
+	uint32_t _epoch;
+public:
+	ArcSet(void);
+
+	void clear(size_t);
+	bool insert(unsigned int, unsigned int);
+};
+
+// Buffers reused by every route decode and evaluation run on a thread, so
+// the steady state of the swarm doesn't touch the allocator
+class Scratch {
+public:
+	std::vector<unsigned int> route;
+	std::vector<unsigned int> pending;
+	std::vector<unsigned int> order;
+	std::vector<double> noise;
+	ArcSet used;
+
+	Scratch(void);
+
+	static Scratch &local(void);
+};
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __shared_best_h__
+#define __shared_best_h__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "graph.h"
+#include "particle.h"
+
+// Global best of an asynchronous swarm, published under a seqlock. Readers
+// never block: they copy the snapshot and retry if a writer got in the way.
+// Writers, which are rare once the swarm settles, take a mutex. Only plain
+// values are snapshotted (best rows, cost, reward and a route of up to
+// arcs + 1 vertices), a torn copy of them is harmless and thrown away.
+class SharedBest {
+private:
+	size_t _size;
+	size_t _capacity;
+	std::vector<double> _rows;
+	std::vector<unsigned int> _route;
+	double _cost;
+	unsigned int _reward;
+	size_t _length;
+	std::atomic<uint64_t> _version; // odd while a writer is copying
+	std::mutex _write;
+public:
+	SharedBest(Particle const &);
+	SharedBest(SharedBest const &) = delete;
+	SharedBest &operator=(SharedBest const &) = delete;
+
+	bool offer(Particle const &);
+	bool read(Particle &, uint64_t &) const;
+};
+
+#endif
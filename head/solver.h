@@ -0,0 +1,48 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __solver_h__
+#define __solver_h__
+
+#include <memory>
+#include <vector>
+#include "elite.h"
+#include "graph.h"
+#include "pso.h"
+#include "threadpool.h"
+
+// An analyzed graph ready to be solved for any budget, any number of
+// times, from any number of threads at once. Solves share the graph, which
+// is never modified, and the pool, whose loops take turns. Solvers rooted
+// at other starts share both too, their graphs are views into this one's
+// tables.
+class Solver {
+private:
+	std::shared_ptr<Graph const> _graph;
+	std::shared_ptr<ThreadPool> _pool;
+public:
+	Solver(Graph &&, unsigned int = 0, bool = false);
+	Solver(Graph &&, std::shared_ptr<ThreadPool> const &);
+	Solver(std::shared_ptr<Graph const> const &,
+	       std::shared_ptr<ThreadPool> const &);
+
+	Graph const &graph(void) const;
+	Solver rooted(unsigned int) const;
+	std::vector<Solution> solve(double, double, Options const &) const;
+};
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __swarm_h__
+#define __swarm_h__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "aligned.h"
+#include "graph.h"
+#include "particle.h"
+
+// Particles whose positions, velocities and personal bests live in a single
+// aligned particles x (Particle::FIELDS x stride) matrix. Rows are padded to
+// whole cache lines, so threads working on different particles never share
+// one.
+class Swarm {
+private:
+	AlignedVector<double> _storage;
+	std::vector<Particle> _particles;
+public:
+	Swarm(Graph const &, std::shared_ptr<Evaluation const> const &,
+	      unsigned int, uint64_t = 0);
+	Swarm(Swarm const &) = delete;
+	Swarm &operator=(Swarm const &) = delete;
+
+	size_t size(void) const;
+	Particle &operator[](size_t);
+	Particle const &operator[](size_t) const;
+
+	std::vector<Particle>::iterator begin(void);
+	std::vector<Particle>::iterator end(void);
+	std::vector<Particle>::const_iterator begin(void) const;
+	std::vector<Particle>::const_iterator end(void) const;
+};
+
+#endif
@@ -18,9 +18,12 @@
 #ifndef __threadpool_h__
 #define __threadpool_h__
 
+#include <atomic>
 #include <condition_variable>
+#include <cstddef>
 #include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
@@ -28,67 +31,53 @@
 
 class ThreadPool {
 private:
+	// Chunks [next, end) not taken yet from a participant's share. Owner
+	// and thieves take chunks with the same fetch_add.
+	struct alignas(64) Range {
+		std::atomic<size_t> next;
+		size_t end;
+	};
+
 	std::vector<std::thread> _W; // workers
 	std::queue< std::packaged_task<void()> > _T; // tasks
 
 	std::mutex _m; // mutex
 	std::condition_variable _c; // condition
 	bool _r; // ready
+
+	// parallel_for state, slot 0 is the calling thread. Callers from
+	// outside the pool take turns.
+	std::mutex _turn;
+	std::unique_ptr<Range[]> _ranges;
+	std::function<void(size_t, size_t)> const *_body;
+	size_t _n;
+	size_t _grain;
+	unsigned long _generation;
+	std::atomic<size_t> _running;
+	std::condition_variable _done;
+
+	void _work(size_t);
+	void _for(size_t, size_t, std::function<void(size_t, size_t)> const &);
 public:
-	ThreadPool(unsigned int = 0);
+	ThreadPool(unsigned int = 0, bool = false);
 	ThreadPool(ThreadPool const &) = delete;
 	ThreadPool &operator=(ThreadPool const &) = delete;
 	~ThreadPool(void);
 
+	size_t size(void) const;
+
 	template<typename F, typename ...ArgTypes>
 	auto enqueue(F &&f, ArgTypes &&...a)
 		-> std::future<typename std::result_of<F(ArgTypes...)>::type>;
-};
-
-ThreadPool::ThreadPool(unsigned int threads)
-	: _W()
-	, _T()
-	, _m()
-	, _c()
-	, _r(false)
-{
-	if (!threads)
-		threads = std::thread::hardware_concurrency() + 1;
-
-	// Create workers, each try to get a job and do it while there are jobs
-	// to do
-	for (unsigned int i = 0; i < threads; i++) _W.emplace_back([this] {
-		for ( ;; ) {
-			std::packaged_task<void()> t;
-			{
-				std::unique_lock<std::mutex> guard(_m);
-				_c.wait(guard, [this] {
-					return _r || !_T.empty();
-				});
-
-				if (_r && _T.empty())
-					return;
-
-				t = std::move(_T.front()); _T.pop();
-			}
-			t();
-		}
-	});
-}
 
-ThreadPool::~ThreadPool(void)
-{
-	// Before destruction, allow al jobs to finish
-	{
-		std::unique_lock<std::mutex> guard(_m);
-		_r = true;
-	}
-	_c.notify_all();
-
-	// Wait for all jobs
-	for (auto &w : _W)
-		w.join();
-}
+	// Run f(i) for every i in [0, n) on the workers and the calling
+	// thread, returning once all are done. Calls from several threads
+	// take turns. Called from a pool task or from inside another
+	// parallel_for of the same pool, it runs f serially on the calling
+	// thread instead. f must not throw.
+	template <typename F>
+	void parallel_for(size_t, F &&, size_t = 0);
+};
 
 template <typename F, typename... AT>
 auto ThreadPool::enqueue(F &&f, AT &&...a)
@@ -110,4 +99,15 @@ auto ThreadPool::enqueue(F &&f, AT &&...a)
 	return promise;
 }
 
+template <typename F>
+void ThreadPool::parallel_for(size_t n, F &&f, size_t grain)
+{
+	std::function<void(size_t, size_t)> const body =
+		[&f](size_t lo, size_t hi) {
+			for (size_t i = lo; i < hi; i++)
+				f(i);
+		};
+	_for(n, grain, body);
+}
+
 #endif
@@ -0,0 +1,170 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include "adjacency.h"
+
+// A dense lookup table costs 4 V^2 bytes, 16 MiB at this size
+unsigned int const Adjacency::dense_lookup_max = 2048;
+
+Adjacency::Adjacency(unsigned int size)
+	: _size(size)
+	, _offsets(size + 1, 0)
+	, _neighbors()
+	, _lookup()
+{}
+
+Adjacency::Adjacency(unsigned int size, std::vector<Arc> const &A)
+	: _size(size)
+	, _offsets()
+	, _neighbors()
+	, _lookup()
+{
+	// Bucket arcs by origin (counting sort keeps input order per bucket)
+	std::vector<unsigned int> offsets(size + 1, 0);
+	for (auto const &a : A) {
+		assert(a.from < size && a.to < size);
+		offsets[a.from + 1]++;
+	}
+	for (unsigned int i = 0; i < size; i++)
+		offsets[i + 1] += offsets[i];
+
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	std::vector<Neighbor> neighbors(A.size());
+	for (auto const &a : A)
+		neighbors[fill[a.from]++] = Neighbor{a.to, a.reward, a.cost};
+
+	// Sort each row by target and drop repeated arcs. The first one read
+	// wins, as it did when arcs were kept in a map.
+	auto cmp = [](auto const &x, auto const &y) { return x.to < y.to; };
+	auto eq = [](auto const &x, auto const &y) { return x.to == y.to; };
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < size; i++) {
+		auto first = neighbors.begin() + offsets[i];
+		auto last = neighbors.begin() + offsets[i + 1];
+		std::stable_sort(first, last, cmp);
+		last = std::unique(first, last, eq);
+
+		offsets[i] = kept;
+		kept = std::move(first, last, neighbors.begin() + kept)
+			- neighbors.begin();
+	}
+	offsets[size] = kept;
+	neighbors.resize(kept);
+	neighbors.shrink_to_fit();
+
+	_offsets = Buffer<unsigned int>(std::move(offsets));
+	_neighbors = Buffer<Neighbor>(std::move(neighbors));
+
+	// Small graphs get O(1) lookups
+	if (size <= dense_lookup_max) {
+		_lookup = Matrix<unsigned int>(size, size, kept);
+		for (unsigned int i = 0; i < size; i++)
+			for (unsigned int k = _offsets[i]; k < _offsets[i + 1]; k++)
+				_lookup(i, _neighbors[k].to) = k;
+	}
+}
+
+Adjacency::Adjacency(unsigned int size, Buffer<unsigned int> &&offsets,
+		     Buffer<Neighbor> &&neighbors, Matrix<unsigned int> &&lookup)
+	: _size(size)
+	, _offsets(std::move(offsets))
+	, _neighbors(std::move(neighbors))
+	, _lookup(std::move(lookup))
+{
+	assert(_offsets.size() == size + 1);
+	assert(_offsets[size] == _neighbors.size());
+}
+
+unsigned int Adjacency::size(void) const
+{
+	return _size;
+}
+
+unsigned int Adjacency::arcs(void) const
+{
+	return _neighbors.size();
+}
+
+unsigned int Adjacency::find(unsigned int from, unsigned int to) const
+{
+	// Index of arc from -> to, arcs() if there is none
+	assert(from < _size && to < _size);
+	if (_lookup.rows())
+		return _lookup(from, to);
+
+	auto first = begin(from);
+	auto last = end(from);
+	auto it = std::lower_bound(first, last, to, [](auto const &n, auto t) {
+		return n.to < t;
+	});
+	if (it == last || it->to != to)
+		return arcs();
+	return it - _neighbors.data();
+}
+
+Neighbor const &Adjacency::arc(unsigned int k) const
+{
+	assert(k < _neighbors.size());
+	return _neighbors[k];
+}
+
+void Adjacency::set(unsigned int k, double cost, unsigned int reward)
+{
+	assert(k < _neighbors.size());
+	_neighbors[k].cost = cost;
+	_neighbors[k].reward = reward;
+}
+
+Adjacency Adjacency::reversed(void) const
+{
+	// Same arcs, each one pointing back
+	std::vector<Arc> R;
+	R.reserve(arcs());
+	for (unsigned int i = 0; i < _size; i++)
+		for (auto a = begin(i); a != end(i); a++)
+			R.push_back(Arc{a->to, i, a->cost, a->reward});
+	return Adjacency(_size, R);
+}
+
+Neighbor const *Adjacency::begin(unsigned int from) const
+{
+	assert(from < _size);
+	return _neighbors.data() + _offsets[from];
+}
+
+Neighbor const *Adjacency::end(unsigned int from) const
+{
+	assert(from < _size);
+	return _neighbors.data() + _offsets[from + 1];
+}
+
+Buffer<unsigned int> const &Adjacency::offsets(void) const
+{
+	return _offsets;
+}
+
+Buffer<Neighbor> const &Adjacency::neighbors(void) const
+{
+	return _neighbors;
+}
+
+Matrix<unsigned int> const &Adjacency::lookup(void) const
+{
+	return _lookup;
+}
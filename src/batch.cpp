@@ -0,0 +1,284 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "batch.h"
+#include "instance.h"
+#include "overloads.h"
+#include "solver.h"
+#include "threadpool.h"
+
+// Particles times vertices per iteration above which an instance gets the
+// whole pool. Below it the pool's barrier costs about as much as moving
+// the swarm, and instances are better solved side by side.
+static size_t const PARTICLE_LEVEL = size_t(1) << 16;
+
+// Whether a solve is worth the whole pool, or better run next to others
+static bool whole_pool(size_t V, Options const &o, size_t participants)
+{
+	return o.swarm_size >= 2 * participants
+	       && V * o.swarm_size >= PARTICLE_LEVEL;
+}
+
+// Options of the k-th solve: seeded apart, and silent since reports of
+// solves running side by side would mix
+static Options nth(Options const &options, size_t k)
+{
+	Options o = options;
+	o.seed = options.seed + k;
+	o.verbose = false;
+	o.optima = 0;
+	o.incumbents = NULL;
+	return o;
+}
+
+// An instance of the batch and what came out of it
+struct Job {
+	std::string name;
+	std::shared_ptr<Input> in;
+	Instance I;
+	std::string error;
+	std::string out;
+
+	Job(void) : name(), in(), I(), error(), out() {}
+};
+
+static std::string malformed(ParseError const &e)
+{
+	return "malformed instance, line " + std::to_string(e.line()) + ": "
+	       + e.what();
+}
+
+// Instances concatenated in a single input, up to the first one that
+// doesn't parse
+static void read_stream(std::vector<Job> &jobs)
+{
+	auto in = std::make_shared<Input>(STDIN_FILENO);
+	char const *p = in->begin();
+	for ( ;; ) {
+		while (p < in->end() && std::isspace(static_cast<unsigned char>(*p)))
+			p++;
+		if (p == in->end())
+			break;
+
+		Job job;
+		job.name = std::to_string(jobs.size() + 1);
+		job.in = in;
+		try {
+			p = parse_header(*in, p, job.I);
+		} catch (ParseError const &e) {
+			job.error = malformed(e);
+			jobs.push_back(job);
+			break;
+		}
+		jobs.push_back(job);
+	}
+}
+
+// Instance files listed in a manifest, one path per line
+static bool read_manifest(std::string const &path, std::vector<Job> &jobs)
+{
+	std::ifstream manifest(path);
+	if (!manifest)
+		return false;
+
+	std::string line;
+	while (std::getline(manifest, line)) {
+		auto blank = [](unsigned char c) { return std::isspace(c); };
+		line.erase(line.begin(), std::find_if_not(line.begin(),
+							  line.end(), blank));
+		line.erase(std::find_if_not(line.rbegin(), line.rend(),
+					    blank).base(), line.end());
+		if (line.empty())
+			continue;
+
+		Job job;
+		job.name = line;
+		int fd = open(line.c_str(), O_RDONLY);
+		if (fd < 0) {
+			job.error = "can't open it";
+			jobs.push_back(job);
+			continue;
+		}
+		job.in = std::make_shared<Input>(fd);
+		close(fd);
+		try {
+			parse_header(*job.in, job.in->begin(), job.I);
+		} catch (ParseError const &e) {
+			job.error = malformed(e);
+		}
+		jobs.push_back(job);
+	}
+	return true;
+}
+
+// Build the graph of a job and run the solver on it, over the pool when
+// called from outside, or on the calling thread when nested in it
+static void solve(Job &job, APSP engine, size_t budget, Options o,
+		  std::chrono::milliseconds limit,
+		  std::shared_ptr<ThreadPool> const &T, unsigned int threads)
+{
+	// Time limits count from the start of each instance, parsing and
+	// analysis included as in a single run
+	if (limit.count())
+		o.deadline = std::chrono::steady_clock::now() + limit;
+
+	Graph G(job.I.V, job.I.S0);
+	try {
+		G.add_edges(parse_arcs(*job.in, job.I, threads, T.get()));
+	} catch (ParseError const &e) {
+		job.error = malformed(e);
+		return;
+	}
+	G.analyze(o.mst, threads, engine, budget, T.get());
+
+	Solver S(std::move(G), T);
+	std::ostringstream os;
+	os << S.solve(job.I.Cmin, job.I.Cmax, o);
+	job.out = os.str();
+}
+
+int batch(std::string const &source, APSP engine, size_t budget,
+	  Options const &options, std::chrono::milliseconds limit,
+	  unsigned int threads, bool pin)
+{
+	std::vector<Job> jobs;
+	if (source == "-") {
+		read_stream(jobs);
+	} else if (!read_manifest(source, jobs)) {
+		std::cerr << "Can't read manifest " << source << '\n';
+		return 1;
+	}
+
+	// Large instances take the whole pool one after the other, small
+	// ones are solved side by side, one per participant
+	auto T = std::make_shared<ThreadPool>(threads, pin);
+	size_t const participants = T->size() + 1;
+	std::vector<size_t> large, small;
+	for (size_t k = 0; k < jobs.size(); k++) {
+		if (!jobs[k].error.empty())
+			continue;
+		if (whole_pool(jobs[k].I.V, options, participants))
+			large.push_back(k);
+		else
+			small.push_back(k);
+	}
+	if (options.verbose)
+		std::cerr << "Batch:\t" << jobs.size() << " instances, "
+			  << large.size() << " over the whole pool, "
+			  << small.size() << " side by side\n";
+
+	for (size_t k : large)
+		solve(jobs[k], engine, budget, nth(options, k), limit, T,
+		      participants);
+	T->parallel_for(small.size(), [&](size_t i) {
+		solve(jobs[small[i]], engine, budget, nth(options, small[i]),
+		      limit, T, 1);
+	}, 1);
+
+	// Results in input order, each under the name of its instance
+	int status = 0;
+	for (size_t k = 0; k < jobs.size(); k++) {
+		std::cout << (k ? "\n" : "") << "Instance:\t" << jobs[k].name
+			  << '\n';
+		if (jobs[k].error.empty()) {
+			std::cout << jobs[k].out;
+		} else {
+			std::cout << "Error:\t" << jobs[k].error << '\n';
+			status = 1;
+		}
+	}
+	return status;
+}
+
+int queries(std::string const &path, Graph &&G, Options const &options,
+	    std::chrono::milliseconds limit, unsigned int threads, bool pin)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		std::cerr << "Can't read queries " << path << '\n';
+		return 1;
+	}
+	Input in(fd);
+	close(fd);
+	std::vector<Query> Q;
+	try {
+		Q = parse_queries(in, G.size());
+	} catch (ParseError const &e) {
+		std::cerr << "Malformed queries, line " << e.line() << ": "
+			  << e.what() << '\n';
+		return 1;
+	}
+
+	// One solver per start asked for, all on the same tables and pool.
+	// Each one is built by the first query that needs it, the map itself
+	// is filled up front so that lookups don't race with insertions.
+	auto T = std::make_shared<ThreadPool>(threads, pin);
+	Solver S(std::move(G), T);
+	std::map<unsigned int, std::optional<Solver> > roots;
+	for (auto const &q : Q)
+		roots[q.S0];
+	std::mutex m;
+	auto rooted = [&](unsigned int start) -> Solver const & {
+		std::lock_guard<std::mutex> guard(m);
+		auto &R = roots.at(start);
+		if (!R)
+			R.emplace(S.rooted(start));
+		return *R;
+	};
+
+	// Queries are alike in size, so they either take the whole pool one
+	// after the other or are all solved side by side
+	std::vector<std::string> out(Q.size());
+	auto solve = [&](size_t k) {
+		Options o = nth(options, k);
+		if (limit.count())
+			o.deadline = std::chrono::steady_clock::now() + limit;
+		std::ostringstream os;
+		os << rooted(Q[k].S0).solve(Q[k].Cmin, Q[k].Cmax, o);
+		out[k] = os.str();
+	};
+	bool const whole = whole_pool(S.graph().size(), options, T->size() + 1);
+	if (options.verbose)
+		std::cerr << "Queries:\t" << Q.size() << ", " << roots.size()
+			  << " starts, "
+			  << (whole ? "one after the other" : "side by side")
+			  << '\n';
+	if (whole) {
+		for (size_t k = 0; k < Q.size(); k++)
+			solve(k);
+	} else {
+		T->parallel_for(Q.size(), solve, 1);
+	}
+
+	for (size_t k = 0; k < Q.size(); k++)
+		std::cout << (k ? "\n" : "") << "Query:\t" << k + 1 << '\n'
+			  << out[k];
+	return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "elite.h"
+
+Elite::Elite(size_t capacity)
+	: _capacity(capacity)
+	, _pool()
+	, _m()
+{
+	_pool.reserve(_capacity);
+}
+
+bool Elite::offer(Particle const &p)
+{
+	auto const &R = p.best_route();
+	double const cost = p.best_cost();
+	unsigned int const reward = p.best_reward();
+	Evaluation const &ev = *p.evaluation();
+	if (R.empty() || !_capacity || !ev.feasible(cost))
+		return false;
+
+	// Routes as good as each other are ordered by their vertices, so the
+	// pool doesn't depend on the order offers come in from the threads
+	std::lock_guard<std::mutex> guard(_m);
+	auto worse = [&](Solution const &s) {
+		if (ev.better(cost, reward, s.cost, s.reward))
+			return true;
+		if (ev.better(s.cost, s.reward, cost, reward))
+			return false;
+		return R < s.route;
+	};
+
+	// Already in, either way round, and not ahead of the copy kept
+	auto in = std::find_if(_pool.begin(), _pool.end(),
+			       [&R](Solution const &s) {
+		return same(s.route, R);
+	});
+	if (in != _pool.end()) {
+		if (!worse(*in))
+			return false;
+		_pool.erase(in);
+	}
+
+	// Full and not ahead of the last one
+	if (_pool.size() == _capacity && !worse(_pool.back()))
+		return false;
+
+	size_t at = std::find_if(_pool.begin(), _pool.end(), worse)
+		  - _pool.begin();
+	if (_pool.size() == _capacity)
+		_pool.pop_back();
+	_pool.insert(_pool.begin() + at, Solution{R, cost, reward});
+	return true;
+}
+
+bool Elite::same(std::vector<unsigned int> const &a,
+		 std::vector<unsigned int> const &b)
+{
+	// Arcs are undirected, a route walked backwards is the same route
+	return a.size() == b.size()
+	    && (std::equal(a.begin(), a.end(), b.begin())
+		|| std::equal(a.begin(), a.end(), b.rbegin()));
+}
+
+std::vector<Solution> Elite::solutions(void) const
+{
+	std::lock_guard<std::mutex> guard(_m);
+	return _pool;
+}
+
+std::vector<Solution> Elite::top(Particle const &best, size_t k) const
+{
+	// The best first, then the next best routes that differ from it
+	std::vector<Solution> R(1, Solution{best.best_route(),
+					    best.best_cost(),
+					    best.best_reward()});
+	for (Solution const &s : solutions())
+		if (R.size() < k && !same(s.route, R[0].route))
+			R.push_back(s);
+	return R;
+}
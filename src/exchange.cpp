@@ -0,0 +1,150 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+#include "aligned.h"
+#include "exchange.h"
+
+// Slot header, followed by the best priorities and visiting rows and then
+// the route
+struct alignas(CACHE_LINE) SlotHeader {
+	std::atomic<uint64_t> version; // odd while the owner writes
+	double cost;
+	unsigned int reward;
+	unsigned int length;
+};
+
+Exchange::Exchange(unsigned int slots, Graph const &G)
+	: _slots(slots)
+	, _size(G.size())
+	, _capacity(G.adjacency().arcs() + 1)
+	, _stride(sizeof(SlotHeader)
+		  + 2 * Particle::stride(_size) * sizeof(double)
+		  + (_capacity * sizeof(unsigned int) + CACHE_LINE - 1)
+		    / CACHE_LINE * CACHE_LINE)
+	, _map(MAP_FAILED)
+	, _bytes(_slots * _stride)
+	, _self(0)
+{
+	static_assert(std::atomic<uint64_t>::is_always_lock_free,
+		      "slots are shared between processes");
+
+	// Shared and zeroed, so every slot starts unpublished
+	_map = mmap(NULL, _bytes, PROT_READ | PROT_WRITE,
+		    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (_map == MAP_FAILED)
+		throw std::runtime_error("Can't map the exchange area");
+	for (size_t i = 0; i < _slots; i++)
+		new (_slot(i)) SlotHeader();
+}
+
+Exchange::~Exchange(void)
+{
+	munmap(_map, _bytes);
+}
+
+unsigned char *Exchange::_slot(size_t i) const
+{
+	return static_cast<unsigned char *>(_map) + i * _stride;
+}
+
+unsigned int Exchange::slots(void) const
+{
+	return _slots;
+}
+
+unsigned int Exchange::self(void) const
+{
+	return _self;
+}
+
+void Exchange::self(unsigned int slot)
+{
+	_self = slot;
+}
+
+void Exchange::publish(Particle const &p)
+{
+	SlotHeader *h = reinterpret_cast<SlotHeader *>(_slot(_self));
+	double *rows = reinterpret_cast<double *>(h + 1);
+	size_t stride = Particle::stride(_size);
+	unsigned int *route = reinterpret_cast<unsigned int *>(rows + 2 * stride);
+	auto const &R = p.best_route();
+
+	// A route longer than the slot would lose the cost and reward their
+	// meaning, keep the last one published instead
+	if (R.empty() || R.size() > _capacity)
+		return;
+
+	uint64_t v = h->version.load(std::memory_order_relaxed);
+	h->version.store(v + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	h->cost = p.best_cost();
+	h->reward = p.best_reward();
+	h->length = R.size();
+	std::memcpy(rows, p.best_priorities(), _size * sizeof(double));
+	std::memcpy(rows + stride, p.best_visiting(), _size * sizeof(double));
+	std::memcpy(route, R.data(), R.size() * sizeof(unsigned int));
+	h->version.store(v + 2, std::memory_order_release);
+}
+
+bool Exchange::fetch(unsigned int slot, Particle &p) const
+{
+	SlotHeader const *h = reinterpret_cast<SlotHeader const *>(_slot(slot));
+	double const *rows = reinterpret_cast<double const *>(h + 1);
+	size_t stride = Particle::stride(_size);
+	unsigned int const *route =
+		reinterpret_cast<unsigned int const *>(rows + 2 * stride);
+
+	// Copy the slot out under the seqlock, the particle takes it after
+	std::vector<double> pri(_size), vis(_size);
+	std::vector<unsigned int> R;
+	double cost;
+	unsigned int reward;
+	for ( ;; ) {
+		uint64_t v = h->version.load(std::memory_order_acquire);
+		if (!v)
+			return false;
+		if (v & 1) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		cost = h->cost;
+		reward = h->reward;
+		R.assign(route, route + std::min<size_t>(h->length, _capacity));
+		std::memcpy(pri.data(), rows, _size * sizeof(double));
+		std::memcpy(vis.data(), rows + stride, _size * sizeof(double));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (h->version.load(std::memory_order_relaxed) == v)
+			break;
+	}
+
+	// Costs and rewards only hold for the route, never adopt without it
+	if (R.empty())
+		return false;
+	p.adopt(cost, reward, pri.data(), vis.data(), R);
+	return true;
+}
@@ -0,0 +1,118 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fitness_cache.h"
+
+// Finalizer of splitmix64
+static inline uint64_t mix(uint64_t x)
+{
+	x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+	return x ^ (x >> 31);
+}
+
+FitnessCache::FitnessCache(size_t entries)
+	: _shards(SHARDS)
+	, _mask(0)
+	, _repeats(0)
+{
+	// Round the share of each shard up to a power of two
+	size_t per = 1;
+	while (per * SHARDS < entries)
+		per <<= 1;
+	_mask = per - 1;
+	for (Shard &s : _shards)
+		s.table.resize(per);
+}
+
+FitnessCache::Shard &FitnessCache::_shard(Key const &k)
+{
+	return _shards[k.h2 % SHARDS];
+}
+
+FitnessCache::Shard const &FitnessCache::_shard(Key const &k) const
+{
+	return _shards[k.h2 % SHARDS];
+}
+
+bool FitnessCache::find(Key const &k, Fitness &f)
+{
+	Shard &s = _shard(k);
+	std::lock_guard<std::mutex> guard(s.lock);
+	Entry const &e = s.table[k.h1 & _mask];
+	if (!(e.key == k)) {
+		s.misses++;
+		return false;
+	}
+	s.hits++;
+	f = e.fitness;
+	return true;
+}
+
+void FitnessCache::insert(Key const &k, Fitness const &f)
+{
+	Shard &s = _shard(k);
+	std::lock_guard<std::mutex> guard(s.lock);
+	Entry &e = s.table[k.h1 & _mask];
+	e.key = k;
+	e.fitness = f;
+}
+
+void FitnessCache::repeat(void)
+{
+	_repeats.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t FitnessCache::hits(void) const
+{
+	uint64_t n = 0;
+	for (Shard const &s : _shards) {
+		std::lock_guard<std::mutex> guard(s.lock);
+		n += s.hits;
+	}
+	return n;
+}
+
+uint64_t FitnessCache::misses(void) const
+{
+	uint64_t n = 0;
+	for (Shard const &s : _shards) {
+		std::lock_guard<std::mutex> guard(s.lock);
+		n += s.misses;
+	}
+	return n;
+}
+
+uint64_t FitnessCache::repeats(void) const
+{
+	return _repeats.load(std::memory_order_relaxed);
+}
+
+FitnessCache::Key FitnessCache::key(std::vector<unsigned int> const &V)
+{
+	// The length goes in first so that prefixes don't collide, and the
+	// low bit is forced so no order maps to the empty key
+	Key k;
+	k.h1 = mix(V.size() + UINT64_C(0x9e3779b97f4a7c15));
+	k.h2 = mix(V.size() ^ UINT64_C(0x632be59bd9b4e019));
+	for (unsigned int v : V) {
+		k.h1 = mix(k.h1 ^ v);
+		k.h2 = mix(k.h2 + UINT64_C(0x9e3779b97f4a7c15) * (v + 1));
+	}
+	k.h1 |= 1;
+	return k;
+}
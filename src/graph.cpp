@@ -18,127 +18,526 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <functional>
+#include <memory>
 #include <limits>
 #include <numeric>
+#include <queue>
 #include <utility>
 
+#include "adjacency.h"
 #include "edge.h"
 #include "graph.h"
+#include "threadpool.h"
 #include "union_find.h"
 
 
 Graph::Graph(unsigned int size, unsigned int start)
-	: _start(start)
-	, _costs_rewards(size)
-	, _min_costs(size, std::vector<double>(size, INFINITY))
-	, _max_rewards(size, std::vector<unsigned int>(size, 0))
-	, _paths(size, std::vector<unsigned int>(size, size))
+	: _size(size)
+	, _start(start)
+	, _arcs()
+	, _adjacency(size)
+	, _min_costs()
+	, _max_rewards()
+	, _paths()
+	, _lazy()
+	, _home()
 	, _blacklist()
+	, _mst_edges()
 	, _MST(start)
-
+	, _roots(std::make_shared<char const>(0))
 {
 	assert(size != 0);
 	assert(start < size);
 }
 
-void Graph::make_floyd_warshall(void) {
+namespace {
+
+// Side of the square tiles the distance table is split into. Three tiles of
+// doubles and two of unsigned ints must fit comfortably in L1/L2.
+constexpr size_t FW_TILE = 64;
+
+// Relax tile (I, J) through every pivot of tile K. Pivots must be walked in
+// order, the inner min-plus loop is branchless so it can be vectorized. The
+// blends mix 64 and 32 bit lanes, which plain SSE2 can't do, so on x86 the
+// kernel is also cloned for wider instruction sets and picked at load time.
+#if defined(__x86_64__) && defined(__GNUC__)
+__attribute__((target_clones("avx2", "sse4.1", "default")))
+#endif
+void fw_tile(Matrix<double> &d, Matrix<unsigned int> &m,
+	     Matrix<unsigned int> &p, size_t I, size_t J, size_t K)
+{
+	size_t const n = d.rows();
+	size_t const i_end = std::min(I + FW_TILE, n);
+	size_t const j_end = std::min(J + FW_TILE, n);
+	size_t const k_end = std::min(K + FW_TILE, n);
+
+	for (size_t k = K; k < k_end; k++) {
+		double const *dk = d.row(k);
+		unsigned int const *mk = m.row(k);
+
+		for (size_t i = I; i < i_end; i++) {
+			double *di = d.row(i);
+			unsigned int *mi = m.row(i);
+			unsigned int *pi = p.row(i);
+
+			double const dik = di[k];
+			if (std::isinf(dik))
+				continue;
+			unsigned int const mik = mi[k];
+			unsigned int const pik = pi[k];
+
+			#pragma omp simd
+			for (size_t j = J; j < j_end; j++) {
+				double const nd = dik + dk[j];
+				double const od = di[j];
+				unsigned int const om = mi[j];
+				unsigned int const op = pi[j];
+				bool const better = nd < od;
+				di[j] = better ? nd : od;
+				mi[j] = better ? mik + mk[j] : om;
+				pi[j] = better ? pik : op;
+			}
+		}
+	}
+}
+
+}
+
+void Graph::make_floyd_warshall(unsigned int threads, ThreadPool *pool) {
+	_min_costs = Matrix<double>(_size, _size, INFINITY);
+	_max_rewards = Matrix<unsigned int>(_size, _size, 0);
+	_paths = Matrix<unsigned int>(_size, _size, _size);
+
 	// Initialize known costs & rewards
-	for (size_t i = 0; i < _costs_rewards.size(); i++) {
-		for (auto &j : _costs_rewards.at(i)) {
-			_min_costs.at(i).at(j.first) = j.second.cost();
-			_max_rewards.at(i).at(j.first) = j.second.reward();
-			_paths.at(i).at(j.first) = j.first;
+	for (unsigned int i = 0; i < _size; i++) {
+		for (auto a = _adjacency.begin(i); a != _adjacency.end(i); a++) {
+			_min_costs(i, a->to) = a->cost;
+			_max_rewards(i, a->to) = a->reward;
+			_paths(i, a->to) = a->to;
 		}
 	}
 
-	// Get min costs via Dynamic Programming
+	// Get min costs via blocked Floyd-Warshall. Each round first closes
+	// the pivot tile, then the tiles sharing its row or column, then every
+	// other tile. Tiles within the last two phases are independent.
+	size_t const n = _min_costs.rows();
 	auto &d = _min_costs;
 	auto &m = _max_rewards;
 	auto &p = _paths;
-	for (size_t k = 0; k < _min_costs.size(); k++) {
-		for (size_t i = 0; i < _min_costs.size(); i++) {
-			for (size_t j = 0; j < _min_costs.size(); j++) {
-				if (d[i][j] > d[i][k] + d[k][j]) {
-					d[i][j] = d[i][k] + d[k][j];
-					m[i][j] = m[i][k] + m[k][j];
-					p[i][j] = p[i][k];
-				}
-			}
-		}
+
+	// Tiles are processed on the pool given, or on a pool of our own
+	std::unique_ptr<ThreadPool> own;
+	if (!pool) {
+		own.reset(new ThreadPool(threads));
+		pool = own.get();
+	}
+	size_t const tiles = (n + FW_TILE - 1) / FW_TILE;
+
+	for (size_t K = 0; K < n; K += FW_TILE) {
+		fw_tile(d, m, p, K, K, K);
+
+		pool->parallel_for(tiles, [&, K](size_t x) {
+			size_t X = x * FW_TILE;
+			if (X == K)
+				return;
+			fw_tile(d, m, p, K, X, K);
+			fw_tile(d, m, p, X, K, K);
+		}, 1);
+
+		// One job per row of tiles keeps the scheduling cheap
+		pool->parallel_for(tiles, [&, K](size_t i) {
+			size_t I = i * FW_TILE;
+			if (I == K)
+				return;
+			for (size_t J = 0; J < n; J += FW_TILE)
+				if (J != K)
+					fw_tile(d, m, p, I, J, K);
+		}, 1);
 	}
 
 	// Forbid remaining still
-	for (size_t i = 0; i < _min_costs.size(); i++) {
-		_min_costs.at(i).at(i) = INFINITY;
-		_max_rewards.at(i).at(i) = 0;
-		_paths.at(i).at(i) = _paths.size();
+	for (size_t i = 0; i < n; i++) {
+		d(i, i) = INFINITY;
+		m(i, i) = 0;
+		p(i, i) = n;
 	}
 
 	// Blacklist unconnected nodes
 	auto cond = [](auto const &x) { return !std::isinf(x); };
-	for (size_t i = 0; i < d.size(); i++)
-		if (std::find_if(d[i].begin(), d[i].end(), cond) == d[i].end())
+	for (size_t i = 0; i < n; i++)
+		if (std::find_if(d.row(i), d.row(i) + n, cond) == d.row(i) + n)
 			_blacklist.push_back(i);
 };
 
-void Graph::make_mst(void) {
-	// Comparison function for priority queue
-	auto cmp = [this](auto &a, auto &b) {
-		double x = INFINITY;
-		double y = INFINITY;
+void Graph::make_lazy(size_t budget) {
+	_lazy = std::make_shared<PathCache>(_adjacency, budget);
 
-		if (_costs_rewards.at(a.first).count(a.second))
-			x = _costs_rewards.at(a.first).at(a.second).cost();
+	// Every route closes back at the start, keep that tree out of the LRU
+	_home = _lazy->tree(_start);
+}
 
-		if (_costs_rewards.at(b.first).count(b.second))
-			y = _costs_rewards.at(b.first).at(b.second).cost();
+void Graph::make_blacklist(void) {
+	// Blacklist nodes that can't go anywhere else, as the dense tables do
+	for (unsigned int i = 0; i < _size; i++)
+		if (stuck(i))
+			_blacklist.push_back(i);
+}
+
+bool Graph::stuck(unsigned int i) const
+{
+	// No arc leads elsewhere, closed arcs (infinite cost) don't count
+	auto cond = [i](auto const &a) {
+		return a.to != i && std::isfinite(a.cost);
+	};
+	return std::find_if(_adjacency.begin(i), _adjacency.end(i), cond)
+	       == _adjacency.end(i);
+}
 
-		return x < y;
+void Graph::make_mst(void) {
+	// Comparison function for priority queue
+	auto cmp = [this](auto const &a, auto const &b) {
+		return _adjacency.arc(a.second).cost
+			< _adjacency.arc(b.second).cost;
 	};
 
-	// Edges sorted by weight
+	// Edges (origin, arc index) sorted by weight
 	std::vector< std::pair<unsigned int, unsigned int> > E;
-	for (size_t i = 0; i < _costs_rewards.size(); i++)
-		for (auto &j : _costs_rewards.at(i))
-			if (i < j.first)
-				E.emplace_back(i, j.first);
+	for (unsigned int i = 0; i < _size; i++)
+		for (auto a = _adjacency.begin(i); a != _adjacency.end(i); a++)
+			if (i < a->to && std::isfinite(a->cost))
+				E.emplace_back(i, a - _adjacency.begin(0));
 	std::sort(E.begin(), E.end(), cmp);
 
 	// Container for MST edges
-	std::vector< std::pair<unsigned int, unsigned int> > MST_E;
+	auto &MST_E = _mst_edges;
+	MST_E.clear();
 
 	// Create Union-Find
-	UnionFind uf(_costs_rewards.size());
+	UnionFind uf(_size);
 
 	// Do Kruskal's algorithm
 	for (auto &e : E) {
-		if (uf.find(e.first) != uf.find(e.second)) {
-			MST_E.push_back(e);
-			uf.unite(e.first, e.second);
+		unsigned int to = _adjacency.arc(e.second).to;
+		if (uf.find(e.first) != uf.find(to)) {
+			MST_E.emplace_back(e.first, to);
+			uf.unite(e.first, to);
 		}
 	}
 
 	// Add found edges to MST
-	_MST.add_edges(MST_E);
+	_MST.add_edges(_size, MST_E);
 };
 
+void Graph::shorten_paths(unsigned int u, unsigned int v, double c,
+			  unsigned int r, ThreadPool *pool)
+{
+	// Arc u -> v got cheaper. The only paths that improve now take it,
+	// and the best ones take it once: i -> u, the arc, then v -> j. Paths
+	// to u and from v can't improve through it, so row v and column u
+	// stay as they are and every other row is updated in one pass.
+	size_t const n = _size;
+	double *D = _min_costs.row(0);
+	unsigned int *M = _max_rewards.row(0);
+	unsigned int *P = _paths.row(0);
+	double const *dv = D + v * n;
+	unsigned int const *mv = M + v * n;
+
+	auto row = [&](size_t i) {
+		if (i == v)
+			return;
+		// Rows that don't get to v cheaper get nowhere cheaper
+		double const diu = i == u ? 0 : D[i * n + u];
+		double *di = D + i * n;
+		if (!(diu + c < di[v]))
+			return;
+
+		unsigned int const miu = (i == u ? 0 : M[i * n + u]) + r;
+		unsigned int const piu = i == u ? v : P[i * n + u];
+		unsigned int *mi = M + i * n;
+		unsigned int *pi = P + i * n;
+		di[v] = diu + c;
+		mi[v] = miu;
+		pi[v] = piu;
+		for (size_t j = 0; j < n; j++) {
+			double const nd = diu + c + dv[j];
+			if (j != i && nd < di[j]) {
+				di[j] = nd;
+				mi[j] = miu + mv[j];
+				pi[j] = piu;
+			}
+		}
+	};
+	if (pool)
+		pool->parallel_for(n, row);
+	else
+		for (size_t i = 0; i < n; i++)
+			row(i);
+}
+
+void Graph::lengthen_paths(unsigned int u, unsigned int v, double before,
+			   Adjacency const &reverse, ThreadPool *pool)
+{
+	// Arc u -> v got dearer, or its reward changed. Only the paths taking
+	// it are affected, and only towards the targets j that u reached
+	// through v. Sources whose path to such a j cost exactly their way to
+	// u, the arc and v's path lose it, give or take rounding: a few extra
+	// ones are harmless. Lost paths are rebuilt by Dijkstra towards j over
+	// reversed arcs, starting at the sources that kept theirs.
+	size_t const n = _size;
+	double *D = _min_costs.row(0);
+	unsigned int *M = _max_rewards.row(0);
+	unsigned int *P = _paths.row(0);
+	double const *dv = D + v * n;
+
+	std::vector<unsigned int> J;
+	for (size_t j = 0; j < n; j++)
+		if (j != u && P[u * n + j] == v)
+			J.push_back(j);
+
+	// Whether a source took the arc is told by its old way to v. Column v
+	// is rebuilt by the block holding v while others still test it, so
+	// they all read a copy.
+	std::vector<double> to_v(n);
+	for (size_t i = 0; i < n; i++)
+		to_v[i] = D[i * n + v];
+
+	// Targets go in blocks, so finding the lost sources walks the tables
+	// by rows
+	size_t const B = 64;
+	auto block = [&](size_t b) {
+		size_t const first = b * B;
+		size_t const last = std::min(J.size(), first + B);
+		static thread_local std::vector< std::vector<unsigned int> > lost;
+		static thread_local std::vector<unsigned char> mark;
+		lost.resize(B);
+		for (auto &L : lost)
+			L.clear();
+		mark.assign(n, 0);
+
+		for (size_t i = 0; i < n; i++) {
+			// Sources whose way to v doesn't take the arc keep all
+			// their paths
+			double const diu = i == u ? 0 : D[i * n + u];
+			double const *di = D + i * n;
+			if (i == v || std::isinf(diu)
+			    || !(diu + before - to_v[i] <= 1e-9 * to_v[i]))
+				continue;
+			for (size_t k = first; k < last; k++) {
+				size_t const j = J[k];
+				double const via = diu + before + (j == v ? 0 : dv[j]);
+				if (i != j && !std::isinf(via)
+				    && via - di[j] <= 1e-9 * di[j])
+					lost[k - first].push_back(i);
+			}
+		}
+
+		for (size_t k = first; k < last; k++) {
+			size_t const j = J[k];
+			auto const &L = lost[k - first];
+			for (auto i : L)
+				mark[i] = 1;
+
+			// Best arc out of each lost source to a kept one
+			typedef std::pair<double, unsigned int> Item;
+			std::priority_queue< Item, std::vector<Item>,
+					     std::greater<Item> > Q;
+			for (auto i : L) {
+				double &d = D[i * n + j];
+				d = INFINITY;
+				M[i * n + j] = 0;
+				P[i * n + j] = n;
+				for (auto a = _adjacency.begin(i);
+				     a != _adjacency.end(i); a++) {
+					unsigned int w = a->to;
+					if (w == i || mark[w])
+						continue;
+					double dw = w == j ? 0 : D[w * n + j];
+					if (a->cost + dw < d) {
+						d = a->cost + dw;
+						M[i * n + j] = a->reward
+							+ (w == j ? 0 : M[w * n + j]);
+						P[i * n + j] = w;
+					}
+				}
+				if (!std::isinf(d))
+					Q.emplace(d, i);
+			}
+
+			// Then through each other
+			while (!Q.empty()) {
+				auto [c, x] = Q.top(); Q.pop();
+				if (c > D[x * n + j])
+					continue;
+				for (auto a = reverse.begin(x);
+				     a != reverse.end(x); a++) {
+					unsigned int y = a->to;
+					if (!mark[y]
+					    || !(c + a->cost < D[y * n + j]))
+						continue;
+					D[y * n + j] = c + a->cost;
+					M[y * n + j] = M[x * n + j] + a->reward;
+					P[y * n + j] = x;
+					Q.emplace(D[y * n + j], y);
+				}
+			}
+
+			for (auto i : L)
+				mark[i] = 0;
+		}
+	};
+	size_t const blocks = (J.size() + B - 1) / B;
+	if (pool)
+		pool->parallel_for(blocks, block, 1);
+	else
+		for (size_t b = 0; b < blocks; b++)
+			block(b);
+}
+
+void Graph::update_blacklist(unsigned int i)
+{
+	// The blacklist is sorted, only i may have to come in or out
+	auto at = std::lower_bound(_blacklist.begin(), _blacklist.end(), i);
+	bool listed = at != _blacklist.end() && *at == i;
+	if (stuck(i) && !listed)
+		_blacklist.insert(at, i);
+	else if (!stuck(i) && listed)
+		_blacklist.erase(at);
+}
+
+bool Graph::update_mst(unsigned int a, unsigned int b, double before)
+{
+	// Kruskal only looks at arcs going up
+	if (_mst_edges.empty() || !(a < b))
+		return false;
+	double const after = edge(a, b).cost();
+	auto const ab = std::make_pair(a, b);
+	auto it = std::find(_mst_edges.begin(), _mst_edges.end(), ab);
+	bool const in_tree = it != _mst_edges.end();
+
+	// Cheaper tree edges and dearer edges elsewhere change nothing
+	if (in_tree ? !(before < after) : !(after < before))
+		return false;
+
+	if (in_tree)
+		_mst_edges.erase(it);
+
+	// The tree as adjacency lists, and each vertex's parent on its way
+	// to a breadth first from a
+	std::vector< std::vector<unsigned int> > T(_size);
+	for (auto const &e : _mst_edges) {
+		T[e.first].push_back(e.second);
+		T[e.second].push_back(e.first);
+	}
+	auto reach = [&](unsigned int root, std::vector<unsigned int> &parent) {
+		parent.assign(_size, _size);
+		parent[root] = root;
+		std::vector<unsigned int> order(1, root);
+		for (size_t k = 0; k < order.size(); k++)
+			for (unsigned int w : T[order[k]])
+				if (parent[w] == _size) {
+					parent[w] = order[k];
+					order.push_back(w);
+				}
+	};
+	auto cost = [this](unsigned int x, unsigned int y) {
+		return edge(std::min(x, y), std::max(x, y)).cost();
+	};
+	std::vector<unsigned int> from_a, from_b;
+	reach(a, from_a);
+
+	if (in_tree) {
+		// Cut in two, join the halves again with the cheapest arc
+		// between them
+		reach(b, from_b);
+		double best = INFINITY;
+		auto join = ab;
+		for (unsigned int i = 0; i < _size; i++) {
+			if (from_a[i] == _size && from_b[i] == _size)
+				continue;
+			for (auto e = _adjacency.begin(i); e != _adjacency.end(i); e++) {
+				unsigned int w = e->to;
+				bool across = from_a[i] != _size
+					      ? from_b[w] != _size
+					      : from_a[w] != _size;
+				if (i < w && across && e->cost < best) {
+					best = e->cost;
+					join = std::make_pair(i, w);
+				}
+			}
+		}
+		if (!std::isinf(best))
+			_mst_edges.push_back(join);
+		return true;
+	}
+
+	// Not in the tree: it closes a cycle with the tree path from a to b,
+	// and replaces the dearest edge on it if cheaper. If there is no path
+	// it joins two trees of the forest.
+	if (from_a[b] == _size) {
+		if (std::isinf(after))
+			return false;
+		_mst_edges.push_back(ab);
+		return true;
+	}
+	unsigned int dearest = b;
+	for (unsigned int x = b; x != a; x = from_a[x])
+		if (cost(dearest, from_a[dearest]) < cost(x, from_a[x]))
+			dearest = x;
+	if (!(after < cost(dearest, from_a[dearest])))
+		return false;
+	unsigned int p = from_a[dearest];
+	auto out = std::make_pair(std::min(p, dearest), std::max(p, dearest));
+	*std::find(_mst_edges.begin(), _mst_edges.end(), out) = ab;
+	return true;
+}
+
+PathTree const &Graph::path_tree(unsigned int to) const
+{
+	// Valid until this thread looks up another tree
+	return to == _start ? *_home : _lazy->local(to);
+}
+
 std::vector<unsigned int> Graph::best_path(unsigned int from, unsigned int to)
 	const
 {
-	// Build best path using Floyd-Warshall's table
 	std::vector<unsigned int> P;
-	if (_paths.at(from).at(to) == _paths.size())
-		return P;
+	append_path(P, from, to);
+	return P;
+}
+
+void Graph::append_path(std::vector<unsigned int> &P, unsigned int from,
+			unsigned int to) const
+{
+	// Build best path using the shortest path tree rooted at destination
+	if (_lazy) {
+		PathTree const &T = path_tree(to);
+		if (from == to || std::isinf(T.cost[from]))
+			return;
+		while (from != to) {
+			from = T.next[from];
+			P.push_back(from);
+		}
+		return;
+	}
+
+	// Build best path using Floyd-Warshall's table
+	if (_paths(from, to) == _paths.rows())
+		return;
 	while (from != to) {
-		from = _paths.at(from).at(to);
+		from = _paths(from, to);
 		P.push_back(from);
 	}
-	return P;
+}
+
+bool Graph::lazy(void) const
+{
+	return bool(_lazy);
 }
 
 unsigned int Graph::size(void) const
 {
-	return _costs_rewards.size();
+	return _size;
 }
 
 unsigned int Graph::start(void) const
@@ -149,56 +548,206 @@ unsigned int Graph::start(void) const
 void Graph::add_edge(unsigned int from, unsigned int to, double cost,
 		     unsigned int reward)
 {
-	_costs_rewards.at(from).emplace(std::make_pair(to, Edge(cost, reward)));
+	// Arcs are only collected here, analyze() builds the adjacency
+	assert(from < _size && to < _size);
+	_arcs.push_back(Arc{from, to, cost, reward});
+}
+
+void Graph::add_edges(std::vector<Arc> &&A)
+{
+	if (_arcs.empty()) {
+		_arcs = std::move(A);
+		return;
+	}
+	_arcs.insert(_arcs.end(), A.begin(), A.end());
 }
 
 Edge Graph::edge(unsigned int from, unsigned int to) const
 {
 	// If arc exists, return a copy (we don't want users modifying the
 	// graph)
-	if (_costs_rewards.at(from).count(to))
-		return _costs_rewards.at(from).at(to);
+	unsigned int k = _adjacency.find(from, to);
+	if (k != _adjacency.arcs())
+		return Edge(_adjacency.arc(k).cost, _adjacency.arc(k).reward);
 
 	// If arc does not exist, return a dummy one
 	return Edge(INFINITY, 0);
 }
 
+Adjacency const &Graph::adjacency(void) const
+{
+	return _adjacency;
+}
+
 double Graph::min_cost(unsigned int from, unsigned int to) const
 {
-	return _min_costs.at(from).at(to);
+	if (_lazy)
+		return from == to ? INFINITY : path_tree(to).cost[from];
+	return _min_costs(from, to);
 }
 
 unsigned int Graph::max_reward(unsigned int from, unsigned int to) const
 {
-	return _max_rewards.at(from).at(to);
+	if (_lazy)
+		return from == to ? 0 : path_tree(to).reward[from];
+	return _max_rewards(from, to);
+}
+
+// Dense tables only while they take at most this much memory
+size_t const Graph::default_budget = size_t(2) << 30;
+
+APSP Graph::choose(unsigned int V, unsigned int E, size_t budget)
+{
+	// Floyd-Warshall needs V^2 memory and V^3 time. Dijkstra trees cost
+	// about E log V each and only the roots actually asked for are built.
+	// Go dense if it fits and the graph is small or not really sparse.
+	double dense_bytes = 1.0 * V * V * PathCache::tree_bytes(1);
+	if (dense_bytes > budget)
+		return APSP::Lazy;
+	if (V <= 4096 || 4.0 * E * std::log2(V) >= 1.0 * V * V)
+		return APSP::Dense;
+	return APSP::Lazy;
 }
 
-void Graph::analyze(bool generate_mst) {
-	// Generate FLoyd-Warshall table
-	make_floyd_warshall();
+void Graph::analyze(bool generate_mst, unsigned int threads, APSP engine,
+		    size_t budget, ThreadPool *pool) {
+	// Freeze arcs read so far into CSR form
+	_adjacency = Adjacency(_size, _arcs);
+	_arcs.clear();
+	_arcs.shrink_to_fit();
+
+	if (engine == APSP::Auto)
+		engine = choose(_size, _adjacency.arcs(), budget);
+
+	// Generate FLoyd-Warshall table, or leave shortest paths for later
+	if (engine == APSP::Dense) {
+		make_floyd_warshall(threads, pool);
+	} else {
+		make_lazy(budget);
+		make_blacklist();
+	}
 
 	// Generate MST
 	if (generate_mst)
 		make_mst();
 }
 
-std::vector<unsigned int> &Graph::blacklist(void)
+namespace {
+
+// Read-only view of b, keeping alive whatever holds it
+template <typename T>
+Buffer<T> view(Buffer<T> const &b, std::shared_ptr<void const> const &keep)
 {
-	return _blacklist;
+	return Buffer<T>(b.data(), b.size(), keep);
 }
 
-std::vector<unsigned int> Graph::preorder(std::vector<double> const &P,
-					  std::vector<bool> const &V)
+template <typename T>
+Matrix<T> view(Matrix<T> const &m, std::shared_ptr<void const> const &keep)
 {
-	// Prepare a vector to store the route
-	std::vector<unsigned int> R;
-
-	// Ask MST for preorder route using priorities given and skipping some
-	// nodes
-	_MST.preorder(R, P, V);
+	return Matrix<T>(m.rows(), m.cols(), view(m.buffer(), keep));
+}
 
-	// Return to origin
-	R.push_back(_start);
+}
 
+std::shared_ptr<Graph const> Graph::rooted(
+	std::shared_ptr<Graph const> const &G, unsigned int start)
+{
+	assert(start < G->_size);
+	if (start == G->_start)
+		return G;
+
+	// Nothing but the start and the MST depend on it, the adjacency and
+	// shortest path tables are views into G's and keep it alive
+	auto R = std::make_shared<Graph>(G->_size, start);
+	Adjacency const &A = G->_adjacency;
+	R->_adjacency = Adjacency(A.size(), view(A.offsets(), G),
+				  view(A.neighbors(), G), view(A.lookup(), G));
+	R->_min_costs = view(G->_min_costs, G);
+	R->_max_rewards = view(G->_max_rewards, G);
+	R->_paths = view(G->_paths, G);
+	R->_lazy = G->_lazy;
+	if (R->_lazy)
+		R->_home = R->_lazy->tree(start);
+	R->_roots = G->_roots;
+	R->_blacklist = G->_blacklist;
+
+	// The MST itself is the same, only rooted elsewhere
+	R->_mst_edges = G->_mst_edges;
+	if (!R->_mst_edges.empty())
+		R->_MST.add_edges(R->_size, R->_mst_edges);
 	return R;
 }
+
+size_t Graph::update(std::vector<Arc> const &changes, ThreadPool *pool)
+{
+	// Change the cost and reward of arcs already in the graph, and bring
+	// shortest paths, blacklist and MST up to date, one arc at a time.
+	// Infinite costs close arcs. Not to be called while solving, nor
+	// while graphs rooted from this one exist: they are views into its
+	// tables. Returns the number of arcs changed, the rest aren't in the
+	// graph.
+	assert(_roots.use_count() == 1);
+	Adjacency reverse;
+	bool reversed = false;
+	bool tree = false;
+	size_t changed = 0;
+	for (auto const &c : changes) {
+		assert(c.from < _size && c.to < _size);
+		assert(c.cost >= 0);
+		unsigned int k = _adjacency.find(c.from, c.to);
+		if (k == _adjacency.arcs())
+			continue;
+
+		Neighbor const before = _adjacency.arc(k);
+		_adjacency.set(k, c.cost, c.reward);
+		changed++;
+
+		// Cheaper arcs only improve paths, anything else may spoil
+		// the paths taking them
+		bool const cheaper = c.cost < before.cost;
+		bool const worse = before.cost < c.cost
+				   || before.reward != c.reward;
+		if (_lazy) {
+			_lazy->update(c.from, c.to, c.cost, c.reward);
+		} else if (cheaper || worse) {
+			if (reversed) {
+				reverse.set(reverse.find(c.to, c.from), c.cost,
+					    c.reward);
+			} else if (worse) {
+				reverse = _adjacency.reversed();
+				reversed = true;
+			}
+
+			// Loops are on no shortest path
+			if (c.from != c.to && cheaper)
+				shorten_paths(c.from, c.to, c.cost, c.reward,
+					      pool);
+			else if (c.from != c.to)
+				lengthen_paths(c.from, c.to, before.cost,
+					       reverse, pool);
+		}
+
+		update_blacklist(c.from);
+		tree = update_mst(c.from, c.to, before.cost) || tree;
+	}
+
+	if (tree)
+		_MST.add_edges(_size, _mst_edges);
+	if (_lazy)
+		_home = _lazy->tree(_start);
+	return changed;
+}
+
+std::vector<unsigned int> const &Graph::blacklist(void) const
+{
+	return _blacklist;
+}
+
+void Graph::preorder(std::vector<unsigned int> &R, double const *P,
+		     double const *V) const
+{
+	// Ask MST for preorder route using priorities given and skipping some
+	// nodes. The start is left out, routes already begin there.
+	R.clear();
+	_MST.preorder(R, P, V);
+}
@@ -0,0 +1,258 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "graph.h"
+
+// On-disk image of an analyzed graph, in native byte order. A header is
+// followed by the sections below, each starting on a 64 byte boundary so
+// they can be used in place once the file is mapped:
+//
+//	offsets		(V + 1) x uint32	CSR row offsets
+//	neighbors	arcs x Neighbor		CSR targets, rewards & costs
+//	lookup		V x V x uint32		dense arc index (F_LOOKUP)
+//	min_costs	V x V x double		Floyd-Warshall tables (F_DENSE)
+//	max_rewards	V x V x uint32
+//	paths		V x V x uint32
+//	blacklist	blacklisted x uint32
+//	mst		mst_edges x 2 x uint32	MST edges (F_MST)
+
+namespace {
+
+char const MAGIC[8] = {'O', 'O', 'P', 'S', 'G', 'R', 'P', 'H'};
+uint32_t const VERSION = 1;
+
+uint32_t const F_LOOKUP = 1 << 0;
+uint32_t const F_DENSE = 1 << 1;
+uint32_t const F_MST = 1 << 2;
+
+struct Header {
+	char magic[8];
+	uint32_t version;
+	uint32_t flags;
+	uint64_t key;
+	uint64_t bytes;
+	uint32_t size;
+	uint32_t start;
+	uint32_t arcs;
+	uint32_t blacklisted;
+	uint32_t mst_edges;
+	uint32_t neighbor_bytes;
+};
+
+// Section sizes, in the order they appear in the file
+struct Layout {
+	size_t at[8];
+	size_t bytes;
+
+	Layout(Header const &h)
+		: at()
+		, bytes(0)
+	{
+		size_t V = h.size;
+		size_t dense = (h.flags & F_DENSE) ? V * V : 0;
+		size_t sizes[8] = {
+			(V + 1) * sizeof(uint32_t),
+			size_t(h.arcs) * sizeof(Neighbor),
+			(h.flags & F_LOOKUP) ? V * V * sizeof(uint32_t) : 0,
+			dense * sizeof(double),
+			dense * sizeof(uint32_t),
+			dense * sizeof(uint32_t),
+			size_t(h.blacklisted) * sizeof(uint32_t),
+			size_t(h.mst_edges) * 2 * sizeof(uint32_t),
+		};
+
+		bytes = align(sizeof(Header));
+		for (size_t i = 0; i < 8; i++) {
+			at[i] = bytes;
+			bytes = align(bytes + sizes[i]);
+		}
+	}
+
+	static size_t align(size_t n) { return (n + 63) & ~size_t(63); }
+};
+
+// View of one section of a mapped file
+template <typename T>
+Buffer<T> section(std::shared_ptr<void const> const &keep, Layout const &L,
+		  size_t i, size_t n)
+{
+	auto base = static_cast<char const *>(keep.get()) + L.at[i];
+	return Buffer<T>(reinterpret_cast<T const *>(base), n, keep);
+}
+
+void write_at(std::ofstream &out, size_t at, void const *data, size_t n)
+{
+	out.seekp(at);
+	out.write(static_cast<char const *>(data), n);
+}
+
+}
+
+uint64_t Graph::cache_key(char const *data, size_t n)
+{
+	// FNV-1a
+	uint64_t h = UINT64_C(14695981039346656037);
+	for (size_t i = 0; i < n; i++) {
+		h ^= static_cast<unsigned char>(data[i]);
+		h *= UINT64_C(1099511628211);
+	}
+	return h;
+}
+
+void Graph::save(std::string const &path, uint64_t key) const
+{
+	Header h;
+	std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+	h.version = VERSION;
+	h.flags = (_adjacency.lookup().rows() ? F_LOOKUP : 0)
+		| (_lazy ? 0 : F_DENSE)
+		| (_mst_edges.empty() ? 0 : F_MST);
+	h.key = key;
+	h.size = _size;
+	h.start = _start;
+	h.arcs = _adjacency.arcs();
+	h.blacklisted = _blacklist.size();
+	h.mst_edges = _mst_edges.size();
+	h.neighbor_bytes = sizeof(Neighbor);
+
+	Layout L(h);
+	h.bytes = L.bytes;
+
+	// Write next to the destination and rename, so readers never map a
+	// half written file
+	std::string tmp = path + ".tmp." + std::to_string(getpid());
+	{
+		std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+		write_at(out, 0, &h, sizeof(h));
+		write_at(out, L.at[0], _adjacency.offsets().data(),
+			 (_size + 1) * sizeof(uint32_t));
+		write_at(out, L.at[1], _adjacency.neighbors().data(),
+			 h.arcs * sizeof(Neighbor));
+		if (h.flags & F_LOOKUP)
+			write_at(out, L.at[2], _adjacency.lookup().row(0),
+				 size_t(_size) * _size * sizeof(uint32_t));
+		if (h.flags & F_DENSE) {
+			size_t n = size_t(_size) * _size;
+			write_at(out, L.at[3], _min_costs.row(0),
+				 n * sizeof(double));
+			write_at(out, L.at[4], _max_rewards.row(0),
+				 n * sizeof(uint32_t));
+			write_at(out, L.at[5], _paths.row(0),
+				 n * sizeof(uint32_t));
+		}
+		write_at(out, L.at[6], _blacklist.data(),
+			 _blacklist.size() * sizeof(uint32_t));
+		for (size_t i = 0; i < _mst_edges.size(); i++) {
+			uint32_t e[2] = {_mst_edges[i].first, _mst_edges[i].second};
+			write_at(out, L.at[7] + i * sizeof(e), e, sizeof(e));
+		}
+
+		// Pad up to the full size
+		out.seekp(L.bytes - 1);
+		out.put('\0');
+		if (!out)
+			return (void) std::remove(tmp.c_str());
+	}
+	if (std::rename(tmp.c_str(), path.c_str()))
+		std::remove(tmp.c_str());
+}
+
+bool Graph::load(std::string const &path, uint64_t key, bool generate_mst,
+		 APSP engine, size_t budget)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) || size_t(st.st_size) < sizeof(Header)) {
+		close(fd);
+		return false;
+	}
+
+	size_t bytes = st.st_size;
+	void *map = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+	std::shared_ptr<void const> keep(map, [bytes](void const *p) {
+		munmap(const_cast<void *>(p), bytes);
+	});
+
+	// Check this is the graph we were asked for, in a form we can use
+	Header const &h = *static_cast<Header const *>(map);
+	if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) || h.version != VERSION
+	    || h.neighbor_bytes != sizeof(Neighbor) || h.key != key
+	    || h.size != _size || h.start != _start || h.bytes != bytes)
+		return false;
+
+	Layout L(h);
+	if (L.bytes != bytes)
+		return false;
+
+	bool dense = h.flags & F_DENSE;
+	if ((engine == APSP::Dense && !dense) || (engine == APSP::Lazy && dense))
+		return false;
+
+	size_t V = _size;
+
+	Matrix<unsigned int> lookup;
+	if (h.flags & F_LOOKUP)
+		lookup = Matrix<unsigned int>(V, V,
+			section<unsigned int>(keep, L, 2, V * V));
+	_adjacency = Adjacency(V, section<unsigned int>(keep, L, 0, V + 1),
+			       section<Neighbor>(keep, L, 1, h.arcs),
+			       std::move(lookup));
+	_arcs.clear();
+
+	if (dense) {
+		_min_costs = Matrix<double>(V, V,
+			section<double>(keep, L, 3, V * V));
+		_max_rewards = Matrix<unsigned int>(V, V,
+			section<unsigned int>(keep, L, 4, V * V));
+		_paths = Matrix<unsigned int>(V, V,
+			section<unsigned int>(keep, L, 5, V * V));
+	} else {
+		make_lazy(budget);
+	}
+
+	// Read through const views, writable ones would copy the section
+	auto const B = section<uint32_t>(keep, L, 6, h.blacklisted);
+	_blacklist.assign(B.data(), B.data() + B.size());
+
+	// The MST is small, rebuild the tree from its edges
+	if (h.flags & F_MST) {
+		auto const S = section<uint32_t>(keep, L, 7, 2 * h.mst_edges);
+		uint32_t const *M = S.data();
+		_mst_edges.clear();
+		for (size_t i = 0; i < h.mst_edges; i++)
+			_mst_edges.emplace_back(M[2 * i], M[2 * i + 1]);
+		_MST.add_edges(_size, _mst_edges);
+	} else if (generate_mst) {
+		make_mst();
+	}
+
+	return true;
+}
@@ -20,45 +20,89 @@
 
 GTree::GTree(unsigned int id)
 	: _id(id)
-	, _sons()
+	, _parent()
+	, _offsets()
+	, _children()
 {}
 
-void GTree::add_edges(std::vector< std::pair<unsigned int, unsigned int> > &E)
+void GTree::add_edges(unsigned int size,
+		      std::vector< std::pair<unsigned int, unsigned int> > const &E)
 {
-	// Recursively create sons using arcs
-	for (auto it = E.begin(); it != E.end(); ) {
-		// If arc starts where we are, add destination
-		if (it->first == _id) {
-			_sons.emplace_back(it->second);
-			it = E.erase(it);
-		} else {
-			it++;
+	// Undirected adjacency of the edges, bucketed by endpoint
+	std::vector<unsigned int> offsets(size + 1, 0);
+	for (auto &e : E) {
+		offsets[e.first + 1]++;
+		offsets[e.second + 1]++;
+	}
+	for (unsigned int i = 0; i < size; i++)
+		offsets[i + 1] += offsets[i];
+
+	std::vector<unsigned int> adjacent(2 * E.size());
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (auto &e : E) {
+		adjacent[fill[e.first]++] = e.second;
+		adjacent[fill[e.second]++] = e.first;
+	}
+
+	// Orient edges away from the root breadth first. Vertices that can't
+	// be reached keep no parent and stay out of the tree.
+	_parent.assign(size, size);
+	std::vector<unsigned int> order;
+	order.reserve(size);
+	order.push_back(_id);
+	_parent[_id] = _id;
+	for (size_t i = 0; i < order.size(); i++) {
+		unsigned int u = order[i];
+		for (unsigned int k = offsets[u]; k < offsets[u + 1]; k++) {
+			if (_parent[adjacent[k]] == size) {
+				_parent[adjacent[k]] = u;
+				order.push_back(adjacent[k]);
+			}
 		}
 	}
+	_parent[_id] = size;
 
-	for (auto &son : _sons)
-		son.add_edges(E);
+	// Children lists, same counting sort
+	_offsets.assign(size + 1, 0);
+	for (unsigned int v = 0; v < size; v++)
+		if (_parent[v] != size)
+			_offsets[_parent[v] + 1]++;
+	for (unsigned int i = 0; i < size; i++)
+		_offsets[i + 1] += _offsets[i];
+
+	_children.resize(_offsets[size]);
+	fill.assign(_offsets.begin(), _offsets.end() - 1);
+	for (unsigned int v = 0; v < size; v++)
+		if (_parent[v] != size)
+			_children[fill[_parent[v]]++] = v;
 }
 
-void GTree::preorder(std::vector<unsigned int> &R, std::vector<double> const &P,
-		     std::vector<bool> const &V) const
+void GTree::preorder(std::vector<unsigned int> &R, double const *P,
+		     double const *V) const
 {
-	// Filter and sort sons that will be visited
-	std::vector<unsigned int> U;
-	U.reserve(_sons.size());
-
-	for (size_t i = 0; i < _sons.size(); i++)
-		if (V.at(_sons.at(i)._id))
-			U.push_back(i);
+	// Scratch space survives between calls, so this allocates nothing
+	// once it has grown enough
+	static thread_local std::vector<unsigned int> S;
+	S.clear();
+	if (_offsets.empty())
+		return;
 
-	auto cmp = [this, &P](auto const x, auto const y) {
-		return P.at(_sons.at(x)._id) < P.at(_sons.at(y)._id);
+	// Walk the whole tree depth first, emitting vertices that will be
+	// visited. Sons are pushed by decreasing priority so the lowest one is
+	// popped first.
+	auto cmp = [&P](auto const x, auto const y) {
+		return P[x] > P[y];
 	};
-	std::sort(U.begin(), U.end(), cmp);
 
-	// Visit self, then sons
-	for (size_t i = 0; i < U.size(); i++) {
-		R.push_back(_id);
-		_sons.at(i).preorder(R, P, V);
+	S.push_back(_id);
+	while (!S.empty()) {
+		unsigned int u = S.back(); S.pop_back();
+		if (u != _id && V[u] > 0)
+			R.push_back(u);
+
+		size_t at = S.size();
+		S.insert(S.end(), _children.begin() + _offsets[u],
+			 _children.begin() + _offsets[u + 1]);
+		std::sort(S.begin() + at, S.end(), cmp);
 	}
 }
@@ -0,0 +1,69 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <cerrno>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include "incumbents.h"
+
+Incumbents::Incumbents(int fd, std::chrono::steady_clock::time_point start)
+	: _fd(fd)
+	, _start(start)
+	, _m()
+	, _cost(0)
+	, _reward(0)
+	, _any(false)
+{}
+
+void Incumbents::offer(Particle const &p)
+{
+	std::lock_guard<std::mutex> guard(_m);
+	if (_any && !p.evaluation()->better(p.best_cost(), p.best_reward(),
+					    _cost, _reward))
+		return;
+	_cost = p.best_cost();
+	_reward = p.best_reward();
+	_any = true;
+
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - _start).count();
+
+	// Vertices are 1-based, as in the instance and the final output
+	std::ostringstream os;
+	os << "{\"ms\": " << ms
+	   << ", \"cost\": " << p.best_cost()
+	   << ", \"reward\": " << p.best_reward()
+	   << ", \"route\": [";
+	auto const &route = p.best_route();
+	for (size_t i = 0; i < route.size(); i++)
+		os << (i ? ", " : "") << route[i] + 1;
+	os << "]}\n";
+
+	// Lines go out in one write when possible, so short lines of several
+	// processes sharing the descriptor don't interleave
+	std::string const line = os.str();
+	for (size_t done = 0; done < line.size(); ) {
+		ssize_t n = write(_fd, line.data() + done, line.size() - done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return;
+		done += n;
+	}
+}
@@ -0,0 +1,348 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "instance.h"
+#include "threadpool.h"
+
+namespace {
+
+// Below this many bytes of arcs, parsing isn't worth splitting
+size_t const PARALLEL_MIN = size_t(4) << 20;
+
+bool blank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool inline_blank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Parse one number starting at p, skipping leading blanks (newlines too if
+// told so). Throws naming what was expected.
+template <typename T>
+char const *number(Input const &in, char const *p, char const *end, T &value,
+		   char const *what, bool newlines = false)
+{
+	while (p < end && (inline_blank(*p) || (newlines && *p == '\n')))
+		p++;
+
+	auto r = std::from_chars(p, end, value);
+	if (r.ec != std::errc() || (r.ptr < end && !blank(*r.ptr)))
+		throw ParseError(in.line(p), std::string("expected ") + what);
+	return r.ptr;
+}
+
+// Parse arc lines in [p, end)
+void arcs_in(Input const &in, Instance const &I, char const *p,
+	     char const *end, std::vector<Arc> &A)
+{
+	while (p < end) {
+		char const *eol = static_cast<char const *>(
+			std::memchr(p, '\n', end - p));
+		if (!eol)
+			eol = end;
+
+		// Skip blank lines
+		char const *q = p;
+		while (q < eol && inline_blank(*q))
+			q++;
+		if (q == eol) {
+			p = eol + 1;
+			continue;
+		}
+
+		unsigned int id;
+		Arc a;
+		q = number(in, q, eol, id, "arc id");
+		q = number(in, q, eol, a.from, "arc origin");
+		q = number(in, q, eol, a.to, "arc destination");
+		q = number(in, q, eol, a.cost, "arc cost");
+		q = number(in, q, eol, a.reward, "arc profit");
+		while (q < eol && inline_blank(*q))
+			q++;
+
+		if (q != eol)
+			throw ParseError(in.line(q), "trailing characters");
+		if (!a.from || a.from > I.V || !a.to || a.to > I.V)
+			throw ParseError(in.line(p), "arc vertex out of range");
+		if (!std::isfinite(a.cost) || a.cost < 0)
+			throw ParseError(in.line(p), "arc cost must be finite "
+					 "and not negative");
+
+		a.from--;
+		a.to--;
+		A.push_back(a);
+		p = eol + 1;
+	}
+}
+
+}
+
+ParseError::ParseError(size_t line, std::string const &what)
+	: std::runtime_error(what)
+	, _line(line)
+{}
+
+size_t ParseError::line(void) const
+{
+	return _line;
+}
+
+Input::Input(int fd)
+	: _own()
+	, _keep()
+	, _data(NULL)
+	, _size(0)
+{
+	// Map regular files read at their start
+	struct stat st;
+	if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0
+	    && lseek(fd, 0, SEEK_CUR) == 0) {
+		size_t bytes = st.st_size;
+		void *map = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			madvise(map, bytes, MADV_SEQUENTIAL);
+			_keep = std::shared_ptr<void const>(map,
+				[bytes](void const *m) {
+					munmap(const_cast<void *>(m), bytes);
+				});
+			_data = static_cast<char const *>(map);
+			_size = bytes;
+			return;
+		}
+	}
+
+	// Anything else is read in large blocks
+	size_t const block = size_t(1) << 20;
+	for ( ;; ) {
+		size_t at = _own.size();
+		_own.resize(at + block);
+		ssize_t n = read(fd, &_own[at], block);
+		if (n < 0 && errno == EINTR) {
+			_own.resize(at);
+			continue;
+		}
+		_own.resize(at + std::max<ssize_t>(n, 0));
+		if (n <= 0)
+			break;
+	}
+	_data = _own.data();
+	_size = _own.size();
+}
+
+char const *Input::begin(void) const
+{
+	return _data;
+}
+
+char const *Input::end(void) const
+{
+	return _data + _size;
+}
+
+size_t Input::line(char const *p) const
+{
+	// Only used to report errors, counting is fine
+	return 1 + std::count(_data, p, '\n');
+}
+
+Instance::Instance(void)
+	: Cmin(0)
+	, Cmax(0)
+	, V(0)
+	, E(0)
+	, S0(0)
+	, graph(NULL)
+	, arcs(NULL)
+	, end(NULL)
+{}
+
+char const *parse_header(Input const &in, char const *p, Instance &I)
+{
+	char const *end = in.end();
+
+	p = number(in, p, end, I.Cmin, "Cmin", true);
+	p = number(in, p, end, I.Cmax, "Cmax", true);
+	while (p < end && blank(*p))
+		p++;
+	I.graph = p;
+	p = number(in, p, end, I.V, "V", true);
+	p = number(in, p, end, I.E, "E", true);
+	p = number(in, p, end, I.S0, "S0", true);
+
+	if (!I.V)
+		throw ParseError(in.line(I.graph), "graph has no vertices");
+	if (!I.S0 || I.S0 > I.V)
+		throw ParseError(in.line(p), "S0 out of range");
+	I.S0--;
+
+	// Find the end of the E-th arc line, blank lines don't count
+	p = std::find(p, end, '\n');
+	p = p == end ? end : p + 1;
+	I.arcs = p;
+	for (unsigned int i = 0; i < I.E; ) {
+		if (p >= end)
+			throw ParseError(in.line(end), "expected "
+					 + std::to_string(I.E) + " arcs, found "
+					 + std::to_string(i));
+		char const *eol = std::find(p, end, '\n');
+		if (std::find_if_not(p, eol, inline_blank) != eol)
+			i++;
+		p = eol == end ? end : eol + 1;
+	}
+	I.end = p;
+
+	return p;
+}
+
+std::vector<Arc> parse_arcs(Input const &in, Instance const &I,
+			    unsigned int threads, ThreadPool *pool)
+{
+	std::vector<Arc> A;
+	A.reserve(I.E);
+
+	size_t bytes = I.end - I.arcs;
+	if (pool)
+		threads = pool->size();
+	else if (!threads)
+		threads = std::thread::hardware_concurrency();
+	if (bytes < PARALLEL_MIN || threads < 2) {
+		arcs_in(in, I, I.arcs, I.end, A);
+		return A;
+	}
+
+	// Split at line boundaries and parse chunks in parallel, then glue
+	// them back in input order
+	std::vector<char const *> cuts = {I.arcs};
+	for (unsigned int i = 1; i < threads; i++) {
+		char const *p = std::max(cuts.back(), I.arcs + bytes * i / threads);
+		p = std::find(p, I.end, '\n');
+		cuts.push_back(p == I.end ? p : p + 1);
+	}
+	cuts.push_back(I.end);
+
+	// Chunks run on the pool given, or on a pool of our own. The first
+	// error in input order is the one reported.
+	std::unique_ptr<ThreadPool> own;
+	if (!pool) {
+		own.reset(new ThreadPool(threads));
+		pool = own.get();
+	}
+	std::vector< std::vector<Arc> > parts(threads);
+	std::vector<std::exception_ptr> errors(threads);
+	pool->parallel_for(threads, [&](size_t i) {
+		try {
+			arcs_in(in, I, cuts[i], cuts[i + 1], parts[i]);
+		} catch (...) {
+			errors[i] = std::current_exception();
+		}
+	}, 1);
+	for (auto &error : errors)
+		if (error)
+			std::rethrow_exception(error);
+
+	for (auto &part : parts)
+		A.insert(A.end(), part.begin(), part.end());
+	return A;
+}
+
+std::vector<Query> parse_queries(Input const &in, unsigned int V)
+{
+	// One query per line: S0 (one based), Cmin and Cmax. Blank lines are
+	// skipped.
+	std::vector<Query> Q;
+	char const *p = in.begin();
+	char const *end = in.end();
+	while (p < end) {
+		char const *eol = std::find(p, end, '\n');
+		char const *q = std::find_if_not(p, eol, inline_blank);
+		if (q == eol) {
+			p = eol == end ? end : eol + 1;
+			continue;
+		}
+
+		Query query;
+		q = number(in, q, eol, query.S0, "S0");
+		q = number(in, q, eol, query.Cmin, "Cmin");
+		q = number(in, q, eol, query.Cmax, "Cmax");
+		q = std::find_if_not(q, eol, inline_blank);
+
+		if (q != eol)
+			throw ParseError(in.line(q), "trailing characters");
+		if (!query.S0 || query.S0 > V)
+			throw ParseError(in.line(p), "S0 out of range");
+
+		query.S0--;
+		Q.push_back(query);
+		p = eol == end ? end : eol + 1;
+	}
+	return Q;
+}
+
+std::vector< std::vector<unsigned int> > parse_routes(Input const &in)
+{
+	// Routes as the solver prints them: one based vertices joined by "->"
+	// on "Route:" lines. Every other line is skipped.
+	static char const tag[] = "Route:";
+	size_t const n = sizeof(tag) - 1;
+	std::vector< std::vector<unsigned int> > routes;
+	char const *p = in.begin();
+	char const *end = in.end();
+	while (p < end) {
+		char const *eol = std::find(p, end, '\n');
+		char const *q = std::find_if_not(p, eol, inline_blank);
+		if (size_t(eol - q) < n || std::memcmp(q, tag, n)) {
+			p = eol == end ? end : eol + 1;
+			continue;
+		}
+
+		std::vector<unsigned int> R;
+		for (q += n; ; q += 2) {
+			unsigned int v = 0;
+			q = std::find_if_not(q, eol, inline_blank);
+			auto r = std::from_chars(q, eol, v);
+			if (r.ec != std::errc())
+				throw ParseError(in.line(q), "expected route vertex");
+			if (!v)
+				throw ParseError(in.line(q),
+						 "route vertex out of range");
+			R.push_back(v - 1);
+
+			q = std::find_if_not(r.ptr, eol, inline_blank);
+			if (q == eol)
+				break;
+			if (eol - q < 2 || q[0] != '-' || q[1] != '>')
+				throw ParseError(in.line(q), "expected ->");
+		}
+		routes.push_back(R);
+		p = eol == end ? end : eol + 1;
+	}
+	return routes;
+}
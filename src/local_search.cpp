@@ -0,0 +1,315 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include "local_search.h"
+
+// Undirected arc key
+static inline uint64_t key(unsigned int a, unsigned int b)
+{
+	if (a > b)
+		std::swap(a, b);
+	return (uint64_t(a) << 32) | b;
+}
+
+LocalSearch::LocalSearch(Graph const &G, double Cmin, double Cmax)
+	: _graph(G)
+	, _Cmin(Cmin)
+	, _Cmax(Cmax)
+	, _route()
+	, _arcs()
+	, _cost(0)
+	, _reward(0)
+	, _fcost()
+	, _bcost()
+	, _freward()
+	, _breward()
+	, _missing()
+	, _segment()
+	, _removed()
+	, _added()
+{}
+
+bool LocalSearch::load(std::vector<unsigned int> const &R)
+{
+	_route = R;
+	_index();
+
+	// Arcs must exist and be used once, as the particle evaluation
+	// penalizes anything else
+	return R.size() >= 2 && std::isfinite(_cost)
+	       && _arcs.size() == R.size() - 1;
+}
+
+void LocalSearch::_index(void)
+{
+	size_t L = _route.size();
+	_arcs.clear();
+	_fcost.assign(L, 0);
+	_bcost.assign(L, 0);
+	_freward.assign(L, 0);
+	_breward.assign(L, 0);
+	_missing.assign(L, 0);
+
+	for (size_t k = 0; k + 1 < L; k++) {
+		unsigned int a = _route[k], b = _route[k + 1];
+		Edge f = _graph.edge(a, b), r = _graph.edge(b, a);
+		_arcs.insert(key(a, b));
+		_fcost[k + 1] = _fcost[k] + f.cost();
+		_freward[k + 1] = _freward[k] + f.reward();
+		bool back = std::isfinite(r.cost());
+		_bcost[k + 1] = _bcost[k] + (back ? r.cost() : 0);
+		_breward[k + 1] = _breward[k] + r.reward();
+		_missing[k + 1] = _missing[k] + !back;
+	}
+	_cost = L ? _fcost[L - 1] : 0;
+	_reward = L ? _freward[L - 1] : 0;
+}
+
+bool LocalSearch::_fits(uint64_t const *removed, size_t nr,
+			uint64_t const *added, size_t na) const
+{
+	// Added arcs must be new, or free once the removed ones are gone
+	for (size_t i = 0; i < na; i++) {
+		for (size_t j = 0; j < i; j++)
+			if (added[i] == added[j])
+				return false;
+		uint64_t const *end = removed + nr;
+		if (_arcs.count(added[i])
+		    && std::find(removed, end, added[i]) == end)
+			return false;
+	}
+	return true;
+}
+
+bool LocalSearch::_improves(double cost, unsigned int reward) const
+{
+	double const eps = 1e-9;
+	double v = std::max(0.0, _Cmin - cost) + std::max(0.0, cost - _Cmax);
+	double w = violation();
+	if (v < w - eps)
+		return true;
+	if (v > w + eps)
+		return false;
+	if (reward != _reward)
+		return reward > _reward;
+	return cost < _cost - eps;
+}
+
+bool LocalSearch::_splice(size_t i, size_t j, double est_cost, long est_reward)
+{
+	// Cheap estimate from the shortest path tables first
+	if (est_reward < 0 || !std::isfinite(est_cost)
+	    || !_improves(est_cost, est_reward))
+		return false;
+
+	// Then the exact route: R[i] -> _segment -> R[j] replacing
+	// R[i] -> ... -> R[j]
+	std::vector<unsigned int> &S = _segment;
+	if (S.empty() || S.back() != _route[j])
+		return false;
+
+	_removed.clear();
+	for (size_t t = i; t < j; t++)
+		_removed.push_back(key(_route[t], _route[t + 1]));
+	_added.clear();
+	double cost = _cost - (_fcost[j] - _fcost[i]);
+	long reward = long(_reward) - (_freward[j] - _freward[i]);
+	unsigned int u = _route[i];
+	for (unsigned int v : S) {
+		Edge e = _graph.edge(u, v);
+		cost += e.cost();
+		reward += e.reward();
+		_added.push_back(key(u, v));
+		u = v;
+	}
+	if (!_improves(cost, reward)
+	    || !_fits(_removed.data(), _removed.size(), _added.data(),
+		      _added.size()))
+		return false;
+
+	_route.erase(_route.begin() + i + 1, _route.begin() + j);
+	_route.insert(_route.begin() + i + 1, S.begin(), S.end() - 1);
+	_index();
+	return true;
+}
+
+bool LocalSearch::_insert(void)
+{
+	// R[k] -> R[k + 1] becomes R[k] ~> v ~> R[k + 1] along shortest paths
+	for (size_t k = 0; k + 1 < _route.size(); k++) {
+		unsigned int a = _route[k], b = _route[k + 1];
+		Edge ab = _graph.edge(a, b);
+		for (unsigned int v = 0; v < _graph.size(); v++) {
+			if (v == a || v == b)
+				continue;
+			double cost = _cost - ab.cost() + _graph.min_cost(a, v)
+				      + _graph.min_cost(v, b);
+			long reward = long(_reward) - ab.reward()
+				      + _graph.max_reward(a, v)
+				      + _graph.max_reward(v, b);
+
+			_segment.clear();
+			if (std::isfinite(cost) && _improves(cost, reward)) {
+				_graph.append_path(_segment, a, v);
+				_graph.append_path(_segment, v, b);
+			}
+			if (_splice(k, k + 1, cost, reward))
+				return true;
+		}
+	}
+	return false;
+}
+
+bool LocalSearch::_remove(void)
+{
+	// R[k - 1] -> R[k] -> R[k + 1] becomes R[k - 1] ~> R[k + 1]
+	for (size_t k = 1; k + 1 < _route.size(); k++) {
+		unsigned int a = _route[k - 1], b = _route[k + 1];
+		if (a == b)
+			continue;
+		double cost = _cost - (_fcost[k + 1] - _fcost[k - 1])
+			      + _graph.min_cost(a, b);
+		long reward = long(_reward)
+			      - (_freward[k + 1] - _freward[k - 1])
+			      + _graph.max_reward(a, b);
+
+		_segment.clear();
+		if (std::isfinite(cost) && _improves(cost, reward))
+			_graph.append_path(_segment, a, b);
+		if (_splice(k - 1, k + 1, cost, reward))
+			return true;
+	}
+	return false;
+}
+
+bool LocalSearch::_swap(void)
+{
+	// R[k - 1] -> R[k] -> R[k + 1] becomes R[k - 1] ~> v ~> R[k + 1]
+	for (size_t k = 1; k + 1 < _route.size(); k++) {
+		unsigned int a = _route[k - 1], b = _route[k + 1];
+		unsigned int x = _route[k];
+		double base = _cost - (_fcost[k + 1] - _fcost[k - 1]);
+		long rest = long(_reward) - (_freward[k + 1] - _freward[k - 1]);
+		for (unsigned int v = 0; v < _graph.size(); v++) {
+			if (v == a || v == b || v == x)
+				continue;
+			double cost = base + _graph.min_cost(a, v)
+				      + _graph.min_cost(v, b);
+			long reward = rest + _graph.max_reward(a, v)
+				      + _graph.max_reward(v, b);
+
+			_segment.clear();
+			if (std::isfinite(cost) && _improves(cost, reward)) {
+				_graph.append_path(_segment, a, v);
+				_graph.append_path(_segment, v, b);
+			}
+			if (_splice(k - 1, k + 1, cost, reward))
+				return true;
+		}
+	}
+	return false;
+}
+
+bool LocalSearch::_two_opt(void)
+{
+	// ... p -> R[i] ... R[j] -> q ... becomes p -> R[j] ... R[i] -> q
+	size_t L = _route.size();
+	for (size_t i = 1; i + 1 < L; i++) {
+		unsigned int p = _route[i - 1];
+		Edge pi = _graph.edge(p, _route[i]);
+		for (size_t j = i + 1; j + 1 < L; j++) {
+			// Every arc of the segment must exist backwards
+			if (_missing[j] != _missing[i])
+				break;
+
+			unsigned int q = _route[j + 1];
+			Edge pj = _graph.edge(p, _route[j]);
+			Edge iq = _graph.edge(_route[i], q);
+			if (!std::isfinite(pj.cost())
+			    || !std::isfinite(iq.cost()))
+				continue;
+			Edge jq = _graph.edge(_route[j], q);
+
+			double cost = _cost - pi.cost() - jq.cost() + pj.cost()
+				      + iq.cost() - (_fcost[j] - _fcost[i])
+				      + (_bcost[j] - _bcost[i]);
+			long reward = long(_reward) - pi.reward() - jq.reward()
+				      + pj.reward() + iq.reward()
+				      - (_freward[j] - _freward[i])
+				      + (_breward[j] - _breward[i]);
+			unsigned int ri = _route[i], rj = _route[j];
+			uint64_t rm[] = { key(p, ri), key(rj, q) };
+			uint64_t ad[] = { key(p, rj), key(ri, q) };
+			if (reward < 0 || !_improves(cost, reward)
+			    || !_fits(rm, 2, ad, 2))
+				continue;
+
+			std::reverse(_route.begin() + i,
+				     _route.begin() + j + 1);
+			_index();
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t LocalSearch::run(size_t moves)
+{
+	// Cheap moves first, 2-opt only once they are exhausted
+	size_t applied = 0;
+	while (!moves || applied < moves) {
+		if (!_insert() && !_swap() && !_remove() && !_two_opt())
+			break;
+		applied++;
+	}
+	return applied;
+}
+
+std::vector<unsigned int> const &LocalSearch::route(void) const
+{
+	return _route;
+}
+
+double LocalSearch::cost(void) const
+{
+	return _cost;
+}
+
+unsigned int LocalSearch::reward(void) const
+{
+	return _reward;
+}
+
+double LocalSearch::violation(void) const
+{
+	return std::max(0.0, _Cmin - _cost) + std::max(0.0, _cost - _Cmax);
+}
+
+bool LocalSearch::better(LocalSearch const &other) const
+{
+	double const eps = 1e-9;
+	if (violation() < other.violation() - eps)
+		return true;
+	if (violation() > other.violation() + eps)
+		return false;
+	if (_reward != other._reward)
+		return _reward > other._reward;
+	return _cost < other._cost - eps;
+}
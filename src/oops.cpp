@@ -15,32 +15,176 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "batch.h"
+#include "elite.h"
+#include "exchange.h"
 #include "graph.h"
+#include "incumbents.h"
+#include "instance.h"
 #include "overloads.h"
 #include "parse_opts.h"
 #include "particle.h"
 #include "pso.h"
+#include "solver.h"
+#include "threadpool.h"
+
+// Restrict this process to its share of the cores
+static void pin_share(unsigned int slot, unsigned int slots, unsigned int cores)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	unsigned int first = slot * cores / slots;
+	unsigned int last = std::max(first + 1, (slot + 1) * cores / slots);
+	for (unsigned int c = first; c < last && c < cores; c++)
+		CPU_SET(c, &set);
+	sched_setaffinity(0, sizeof(set), &set);
+#else
+	(void)slot; (void)slots; (void)cores;
+#endif
+}
 
 int main(int const argc, char const **argv)
 {
+	// Time limits count from here, parsing and analysis included
+	auto const start = std::chrono::steady_clock::now();
+
 	if (parse_opts(argc, argv))
 		return 0;
 
 	if (VM.at("verbose").as<bool>())
 		verbose_opts();
 
-	double Cmin;
-	double Cmax;
-	unsigned int V;
-	unsigned int E;
-	unsigned int S0;
+	APSP engine;
+	if (VM.at("apsp").as<std::string>() == "auto") {
+		engine = APSP::Auto;
+	} else if (VM.at("apsp").as<std::string>() == "dense") {
+		engine = APSP::Dense;
+	} else if (VM.at("apsp").as<std::string>() == "lazy") {
+		engine = APSP::Lazy;
+	} else {
+		std::cerr << "Unknown --apsp engine: "
+			  << VM.at("apsp").as<std::string>() << '\n';
+		return 1;
+	}
+
+	Islands islands = {
+		VM.at("islands").as<unsigned int>(),
+		VM.at("migration-interval").as<unsigned int>(),
+		VM.at("migrants").as<unsigned int>(),
+		true,
+		NULL
+	};
+	if (VM.at("topology").as<std::string>() == "full") {
+		islands.ring = false;
+	} else if (VM.at("topology").as<std::string>() != "ring") {
+		std::cerr << "Unknown --topology: "
+			  << VM.at("topology").as<std::string>() << '\n';
+		return 1;
+	}
+
+	Polish polish_opts = {
+		VM.at("local-search").as<unsigned int>(),
+		VM.at("local-search-moves").as<unsigned int>(),
+		VM.at("memetic").as<unsigned int>(),
+		VM.at("memetic-moves").as<unsigned int>()
+	};
+
+	// Draw a seed when none was given, and tell it so the run can be
+	// repeated
+	uint64_t seed = VM.at("seed").as<uint64_t>();
+	if (!seed) {
+		std::random_device rd;
+		seed = (uint64_t(rd()) << 32) | rd();
+	}
+	if (VM.at("verbose").as<bool>())
+		std::cerr << "Seed:\t" << seed << '\n';
+
+	Options options;
+	options.max_cycles = VM.at("max-cycles").as<unsigned int>();
+	options.swarm_size = VM.at("swarm-size").as<unsigned int>();
+	options.social_factor = VM.at("social-factor").as<double>();
+	options.cognitive_factor = VM.at("cognitive-factor").as<double>();
+	options.max_velocity = VM.at("max-velocity").as<double>();
+	options.mst = VM.at("mst").as<bool>();
+	options.random = VM.at("random").as<bool>();
+	options.verbose = VM.at("verbose").as<bool>();
+	options.optima = VM.at("optima").as<unsigned int>();
+	options.seed = seed;
+	options.async = VM.at("async").as<bool>();
+	options.evaluations = VM.at("max-evaluations").as<uint64_t>();
+	options.islands = islands;
+	options.polish = polish_opts;
+	options.fitness_cache = VM.at("fitness-cache").as<size_t>();
+	options.top_k = VM.at("top-k").as<unsigned int>();
+
+	// With a time limit the deadline ends the search, not the iteration
+	// count, unless one was asked for
+	std::chrono::milliseconds limit(VM.at("time-limit").as<unsigned int>());
+	if (limit.count() && VM.at("max-cycles").defaulted())
+		options.max_cycles = UINT_MAX;
+
+	// Routes of earlier runs to start from
+	std::string warm = VM.at("warm-start").as<std::string>();
+	if (!warm.empty()) {
+		int fd = open(warm.c_str(), O_RDONLY);
+		if (fd < 0) {
+			std::cerr << "Can't read warm start routes " << warm
+				  << '\n';
+			return 1;
+		}
+		Input routes(fd);
+		close(fd);
+		try {
+			options.warm_start = parse_routes(routes);
+		} catch (ParseError const &e) {
+			std::cerr << "Malformed warm start routes, line "
+				  << e.line() << ": " << e.what() << '\n';
+			return 1;
+		}
+	}
+
+	unsigned int threads = VM.at("threads").as<unsigned int>();
+	bool pin = VM.at("pin-threads").as<bool>();
+	size_t budget = size_t(VM.at("memory-budget").as<unsigned int>()) << 20;
+
+	// Many instances, each one solved as below
+	std::string source = VM.at("batch").as<std::string>();
+	if (!source.empty())
+		return batch(source, engine, budget, options, limit, threads,
+			     pin);
 
-	std::cin >> Cmin;
-	std::cin >> Cmax;
-	std::cin >> V;
-	std::cin >> E;
-	std::cin >> S0; S0--;
+	// Read the header and locate the arcs, they are only parsed if the
+	// graph can't be loaded from cache
+	Input in(STDIN_FILENO);
+	Instance I;
+	try {
+		parse_header(in, in.begin(), I);
+	} catch (ParseError const &e) {
+		std::cerr << "Malformed instance, line " << e.line() << ": "
+			  << e.what() << '\n';
+		return 1;
+	}
+
+	double Cmin = I.Cmin;
+	double Cmax = I.Cmax;
+	unsigned int V = I.V;
+	unsigned int E = I.E;
+	unsigned int S0 = I.S0;
 
 	if (VM.at("verbose").as<bool>()) {
 		std::cerr << "Cmin:\t"
@@ -58,38 +202,129 @@ int main(int const argc, char const **argv)
 
 	Graph G(V, S0);
 
-	for (unsigned int i = 0; i < E; i++) {
-		unsigned int id;
-		unsigned int from;
-		unsigned int to;
-		double cost;
-		unsigned int score;
+	// Budgets don't change the graph, leave them out of the cache key
+	std::string cache = VM.at("graph-cache").as<std::string>();
+	uint64_t key = Graph::cache_key(I.graph, I.end - I.graph);
 
-		std::cin >> id >> from >> to >> cost >> score;
-		G.add_edge(from - 1, to - 1, cost, score);
-	}
+	if (!cache.empty()
+	    && G.load(cache, key, options.mst, engine, budget)) {
+		if (VM.at("verbose").as<bool>())
+			std::cerr << "Graph loaded from " << cache << '\n';
+	} else {
+		try {
+			G.add_edges(parse_arcs(in, I, threads));
+		} catch (ParseError const &e) {
+			std::cerr << "Malformed instance, line " << e.line()
+				  << ": " << e.what() << '\n';
+			return 1;
+		}
 
-	if (VM.at("verbose").as<bool>())
-		std::cerr << "Analyzing graph...\n";
-	G.analyze(VM.at("mst").as<bool>());
+		if (VM.at("verbose").as<bool>())
+			std::cerr << "Analyzing graph...\n";
+		G.analyze(options.mst, threads, engine, budget);
+
+		if (!cache.empty())
+			G.save(cache, key);
+	}
 	if (VM.at("verbose").as<bool>()) {
+		std::cerr << "Shortest paths:\t"
+			  << (G.lazy() ? "lazy" : "dense") << '\n';
 		std::cerr << "Blacklisted nodes: \t";
 		for (auto &b : G.blacklist())
 			std::cerr << b << ' ';
 		std::cerr << '\n';
 	}
 
-	Particle best = std::move(pso(G, Cmin, Cmax,
-				      VM.at("max-cycles").as<unsigned int>(),
-				      VM.at("swarm-size").as<unsigned int>(),
-				      VM.at("social-factor").as<double>(),
-				      VM.at("cognitive-factor").as<double>(),
-				      VM.at("mst").as<bool>(),
-				      VM.at("random").as<bool>(),
-				      VM.at("verbose").as<bool>(),
-				      VM.at("optima").as<unsigned int>()));
-
-	std::cout << best << '\n';
+	// Many budgets and starts on the graph just analyzed
+	std::string queries_path = VM.at("queries").as<std::string>();
+	if (!queries_path.empty())
+		return queries(queries_path, std::move(G), options, limit,
+			       threads, pin);
+
+	// Time limits count from the start, parsing and analysis included
+	if (limit.count())
+		options.deadline = start + limit;
+
+	int fd = VM.at("incumbents").as<int>();
+	if (fd >= 0 && fcntl(fd, F_GETFD) < 0) {
+		std::cerr << "Can't stream incumbents to descriptor " << fd
+			  << '\n';
+		return 1;
+	}
+	std::unique_ptr<Incumbents> incumbents;
+	if (fd >= 0) {
+		incumbents.reset(new Incumbents(fd, start));
+		options.incumbents = incumbents.get();
+	}
+
+	unsigned int processes = VM.at("processes").as<unsigned int>();
+	if (processes <= 1) {
+		Solver S(std::move(G), threads, pin);
+		std::cout << S.solve(Cmin, Cmax, options);
+		return 0;
+	}
+
+	// Fork the workers after the graph is ready, they share it
+	Exchange X(processes, G);
+	std::vector<pid_t> workers;
+	for (unsigned int p = 0; p < processes; p++) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			std::cerr << "Can't start worker " << p << '\n';
+			break;
+		}
+		if (pid > 0) {
+			workers.push_back(pid);
+			continue;
+		}
+
+		// Split threads among workers, and cores too when pinning
+		unsigned int cores =
+			std::max(1u, std::thread::hardware_concurrency());
+		if (!threads)
+			threads = std::max(1u, cores / processes);
+		if (pin)
+			pin_share(p, processes, cores);
+
+		// Each worker runs its own swarm, trading bests with the rest
+		Options o = options;
+		o.islands.remote = &X;
+		o.seed += p;
+		o.verbose = o.verbose && !p;
+		ThreadPool T(threads);
+		X.self(p);
+		X.publish(pso(G, Cmin, Cmax, o, T));
+		std::cout.flush();
+		_exit(0);
+	}
+
+	for (size_t p = 0; p < workers.size(); p++) {
+		int status;
+		waitpid(workers[p], &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			std::cerr << "Worker " << p << " failed\n";
+	}
+
+	// Gather the best route, and the elite out of every worker's best.
+	// This process never ran pso() so it still needs the evaluation
+	// settings.
+	auto ev = std::make_shared<Evaluation const>(Cmin, Cmax, options.mst);
+	Elite elite(options.top_k > 1 ? options.top_k : 0);
+	Particle best(G, ev), other(G, ev);
+	bool found = false;
+	for (unsigned int p = 0; p < processes; p++) {
+		if (!X.fetch(p, other))
+			continue;
+		elite.offer(other);
+		if (!found || Particle::better(other, best))
+			best = other;
+		found = true;
+	}
+	if (!found) {
+		std::cerr << "No worker finished\n";
+		return 1;
+	}
+	std::cout << elite.top(best, options.top_k);
 
 	return 0;
 }
@@ -16,24 +16,28 @@
  */
 
 #include "overloads.h"
-#include "parse_opts.h"
 
 std::ostream &operator<<(std::ostream &os, Particle const &p)
 {
-	os << "Cost:\t" << p.best_cost() << "\n";
-	os << "Reward:\t" << p.best_reward() << "\n";
+	return os << Solution{p.best_route(), p.best_cost(), p.best_reward()};
+}
+
+std::ostream &operator<<(std::ostream &os, Solution const &s)
+{
+	os << "Cost:\t" << s.cost << "\n";
+	os << "Reward:\t" << s.reward << "\n";
 	os << "Route:\t";
 
-	auto route = std::move(p.best_route());
+	auto const &route = s.route;
 	for (size_t i = 0; i < route.size(); i++)
 		os << route[i] + 1 << (i < route.size() - 1 ? "->" : "");
 
 	return os;
 }
 
-size_t pair_hash::operator()(std::pair<unsigned int, unsigned int> const &v) const
+std::ostream &operator<<(std::ostream &os, std::vector<Solution> const &R)
 {
-	std::hash<unsigned int> hasher;
-	return hasher(v.first) ^ hasher(v.second);
+	for (size_t i = 0; i < R.size(); i++)
+		os << (i ? "\n" : "") << R[i] << '\n';
+	return os;
 }
-
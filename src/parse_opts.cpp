@@ -46,12 +46,111 @@ bool parse_opts(int const argc, char const **argv)
 		("max-cycles",
 			po::value<unsigned int>()->default_value(100, "100"),
 			"Set max program iterations")
+		("async", po::bool_switch()->default_value(false),
+			"Move particles asynchronously against the latest "
+			"global best, without waiting for the whole swarm")
+		("max-evaluations",
+			po::value<uint64_t>()->default_value(0),
+			"Evaluations before stopping in async mode. "
+			"0 means max-cycles * swarm-size.")
+		("islands",
+			po::value<unsigned int>()->default_value(1),
+			"Split the swarm in sub-swarms, each following its "
+			"own best. Ignored in async mode.")
+		("migration-interval",
+			po::value<unsigned int>()->default_value(10),
+			"Iterations between migrations among islands. "
+			"0 means islands never exchange particles.")
+		("migrants",
+			po::value<unsigned int>()->default_value(1),
+			"Best particles each island sends when migrating")
+		("topology",
+			po::value<std::string>()->default_value("ring"),
+			"Island topology: ring (to the next island) or full "
+			"(to every island)")
+		("local-search",
+			po::value<unsigned int>()->default_value(0),
+			"Polish the best route and the next best personal "
+			"bests, this many routes in all, with local search. "
+			"0 disables it.")
+		("local-search-moves",
+			po::value<unsigned int>()->default_value(0),
+			"Improving moves applied per route. 0 means until no "
+			"move improves it.")
+		("memetic",
+			po::value<unsigned int>()->default_value(0),
+			"After every iteration, polish this many of the best "
+			"personal bests with local search and feed them back "
+			"to the swarm. 0 disables it. Ignored in async mode.")
+		("memetic-moves",
+			po::value<unsigned int>()->default_value(10),
+			"Improving moves applied per elite route and iteration")
+		("time-limit",
+			po::value<unsigned int>()->default_value(0),
+			"Wall-clock limit in milliseconds, counted from start. "
+			"With --batch it counts from the start of each "
+			"instance, with --queries from the start of each "
+			"query, after the shared analysis. Iterations are unbounded unless max-cycles is given. "
+			"0 means no limit.")
+		("incumbents",
+			po::value<int>()->default_value(-1),
+			"File descriptor to stream improving solutions to, as "
+			"JSON lines. -1 disables it.")
+		("top-k",
+			po::value<unsigned int>()->default_value(1),
+			"Print this many distinct routes, the best ones found, "
+			"best first.")
+		("fitness-cache",
+			po::value<size_t>()->default_value(0),
+			"Evaluated visiting orders to remember, so that "
+			"repeated orders are not decoded again. 0 disables "
+			"it.")
 		("optima",
 			po::value<unsigned int>()->default_value(0),
 			"Tell the program to stop at certain optima. 0 means do not stop.")
+		("seed",
+			po::value<uint64_t>()->default_value(0),
+			"Random seed. Runs with the same seed give the same "
+			"result. 0 means pick one at random.")
 		("threads",
 			po::value<unsigned int>()->default_value(0),
-			"Threads to use. 0 means hardware determined.");
+			"Threads to use. 0 means hardware determined.")
+		("processes",
+			po::value<unsigned int>()->default_value(1),
+			"Solver processes. Each one runs its own swarm and "
+			"they trade their best every migration-interval "
+			"iterations.")
+		("pin-threads", po::bool_switch()->default_value(false),
+			"Pin each worker thread to a core")
+		("apsp",
+			po::value<std::string>()->default_value("auto"),
+			"Shortest paths engine: dense (Floyd-Warshall), lazy "
+			"(cached Dijkstra trees) or auto.")
+		("memory-budget",
+			po::value<unsigned int>()->default_value(2048),
+			"Memory for shortest path tables, in MiB.")
+		("batch",
+			po::value<std::string>()->default_value(""),
+			"Solve many instances: - reads them concatenated from "
+			"the standard input, anything else is a manifest with "
+			"one instance file per line. --processes, "
+			"--graph-cache, --incumbents and --optima don't apply.")
+		("queries",
+			po::value<std::string>()->default_value(""),
+			"Solve the graph read for every query in this file, one "
+			"per line: S0, Cmin and Cmax. The graph is analyzed "
+			"once, the header's S0, Cmin and Cmax are ignored. "
+			"--processes, --incumbents and --optima don't apply.")
+		("warm-start",
+			po::value<std::string>()->default_value(""),
+			"Start part of the swarm at the routes in this file, as "
+			"printed by earlier runs, and about half of the rest at "
+			"copies of them with a shuffled visiting order. Routes "
+			"that don't fit the graph are left out.")
+		("graph-cache",
+			po::value<std::string>()->default_value(""),
+			"Analyzed graph cache file. Written on first use, "
+			"memory-mapped on later runs of the same instance.");
 
 
 
@@ -82,10 +181,56 @@ void verbose_opts(void)
 			<< VM.at("social-factor").as<double>()
 		  << "\n\t--cognitive-factor\t\t"
 			<< VM.at("cognitive-factor").as<double>()
+		  << "\n\t--async\t\t\t\t"
+			<< VM.at("async").as<bool>()
+		  << "\n\t--max-evaluations\t\t"
+			<< VM.at("max-evaluations").as<uint64_t>()
+		  << "\n\t--islands\t\t\t"
+			<< VM.at("islands").as<unsigned int>()
+		  << "\n\t--migration-interval\t\t"
+			<< VM.at("migration-interval").as<unsigned int>()
+		  << "\n\t--migrants\t\t\t"
+			<< VM.at("migrants").as<unsigned int>()
+		  << "\n\t--topology\t\t\t"
+			<< VM.at("topology").as<std::string>()
+		  << "\n\t--local-search\t\t\t"
+			<< VM.at("local-search").as<unsigned int>()
+		  << "\n\t--local-search-moves\t\t"
+			<< VM.at("local-search-moves").as<unsigned int>()
+		  << "\n\t--memetic\t\t\t"
+			<< VM.at("memetic").as<unsigned int>()
+		  << "\n\t--memetic-moves\t\t\t"
+			<< VM.at("memetic-moves").as<unsigned int>()
+		  << "\n\t--time-limit\t\t\t"
+			<< VM.at("time-limit").as<unsigned int>()
+		  << "\n\t--incumbents\t\t\t"
+			<< VM.at("incumbents").as<int>()
+		  << "\n\t--top-k\t\t\t\t"
+			<< VM.at("top-k").as<unsigned int>()
+		  << "\n\t--fitness-cache\t\t\t"
+			<< VM.at("fitness-cache").as<size_t>()
 		  << "\n\t--optima\t\t\t"
 			<< VM.at("optima").as<unsigned int>()
+		  << "\n\t--seed\t\t\t\t"
+			<< VM.at("seed").as<uint64_t>()
 		  << "\n\t--threads\t\t\t"
 			<< VM.at("threads").as<unsigned int>()
+		  << "\n\t--processes\t\t\t"
+			<< VM.at("processes").as<unsigned int>()
+		  << "\n\t--pin-threads\t\t\t"
+			<< VM.at("pin-threads").as<bool>()
+		  << "\n\t--apsp\t\t\t\t"
+			<< VM.at("apsp").as<std::string>()
+		  << "\n\t--memory-budget\t\t\t"
+			<< VM.at("memory-budget").as<unsigned int>()
+		  << "\n\t--batch\t\t\t\t"
+			<< VM.at("batch").as<std::string>()
+		  << "\n\t--queries\t\t\t"
+			<< VM.at("queries").as<std::string>()
+		  << "\n\t--warm-start\t\t\t"
+			<< VM.at("warm-start").as<std::string>()
+		  << "\n\t--graph-cache\t\t\t"
+			<< VM.at("graph-cache").as<std::string>()
 		  << "\n\n";
 
 }
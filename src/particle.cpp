@@ -18,36 +18,107 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <ctime>
-#include <deque>
 #include <numeric>
-#include <random>
-#include <unordered_set>
 #include <utility>
 #include "edge.h"
 #include "overloads.h"
 #include "particle.h"
+#include "scratch.h"
+#include "swarm.h"
+
+Evaluation::Evaluation(double cmin, double cmax, bool mst, size_t entries)
+	: Cmin(cmin)
+	, Cmax(cmax)
+	, penalty(cmax)
+	, use_mst(mst)
+	, cache(entries ? new FitnessCache(entries) : NULL)
+{}
+
+bool Evaluation::feasible(double cost) const
+{
+	// Penalized costs fall outside the budget
+	return cost > Cmin && cost < Cmax;
+}
 
-double Particle::_penalty;
-double Particle::_Cmin;
-double Particle::_Cmax;
-bool Particle::_use_mst;
+bool Evaluation::better(double ca, unsigned int ra, double cb,
+			unsigned int rb) const
+{
+	// Feasible routes win by reward, the rest by cost (try to repair by
+	// cost first, then by reward, otherwise we will get only undfeasible
+	// solutions)
+	bool fa = feasible(ca);
+	bool fb = feasible(cb);
+	if (fa != fb)
+		return fa;
+	if (fa)
+		return ra > rb;
+	return ca < cb;
+}
+
+Particle::Particle(Graph const &G, std::shared_ptr<Evaluation const> const &ev)
+	: _graph(&G)
+	, _evaluation(ev)
+	, _times_no_improve(0)
+	, _cost(INFINITY)
+	, _reward(0)
+	, _best_cost(NAN)
+	, _best_reward(0)
+	, _rng()
+	, _own(FIELDS * stride(G.size()), 0)
+	, _priorities(NULL)
+	, _visiting(NULL)
+	, _priorities_speed(NULL)
+	, _visiting_speed(NULL)
+	, _best_priorities(NULL)
+	, _best_visiting(NULL)
+	, _best_route()
+	, _last_key()
+	, _last()
+{
+	assert(G.size() > 0);
+	_bind(_own.data());
+}
 
-Particle::Particle(Graph &G)
-	: _graph(G)
+Particle::Particle(Graph const &G, std::shared_ptr<Evaluation const> const &ev,
+		   double *rows, Random const &rng)
+	: _graph(&G)
+	, _evaluation(ev)
 	, _times_no_improve(0)
 	, _cost(INFINITY)
 	, _reward(0)
 	, _best_cost(NAN)
 	, _best_reward(0)
-	, _priorities(G.size(), NAN)
-	, _visiting(G.size(), true)
-	, _priorities_speed(G.size(), NAN)
-	, _visiting_speed(G.size(), NAN)
-	, _best_priorities(G.size(), NAN)
-	, _best_visiting(G.size(), true)
+	, _rng(rng)
+	, _own()
+	, _priorities(NULL)
+	, _visiting(NULL)
+	, _priorities_speed(NULL)
+	, _visiting_speed(NULL)
+	, _best_priorities(NULL)
+	, _best_visiting(NULL)
+	, _best_route()
+	, _last_key()
+	, _last()
 {
 	assert(G.size() > 0);
+	_bind(rows);
+}
+
+Particle::Particle(Particle const &other)
+	: Particle(*other._graph, other._evaluation)
+{
+	*this = other;
+}
+
+void Particle::_bind(double *rows)
+{
+	size_t n = stride(_graph->size());
+	_priorities = rows;
+	_visiting = rows + n;
+	_priorities_speed = rows + 2 * n;
+	_visiting_speed = rows + 3 * n;
+	_best_priorities = rows + 4 * n;
+	_best_visiting = rows + 5 * n;
 }
 
 Particle &Particle::operator=(Particle const &other)
@@ -55,83 +126,110 @@ Particle &Particle::operator=(Particle const &other)
 	if (this == &other)
 		return *this;
 
+	// Rows are bound to a graph of the same size, only the pointer moves
+	assert(_graph->size() == other._graph->size());
 	_graph = other._graph;
+	_evaluation = other._evaluation;
 
 	_cost = other._cost;
 	_best_cost = other._best_cost;
 
 	_reward = other._reward;
 	_best_reward = other._best_reward;
+	_best_route = other._best_route;
 
-	_priorities = other._priorities;
-	_visiting = other._visiting;
-
-	_priorities_speed = other._priorities_speed;
-	_visiting_speed = other._visiting_speed;
-
-	_best_priorities = other._best_priorities;
-	_best_visiting = other._best_visiting;
+	// Rows are laid out back to back, copy them all at once
+	std::copy(other._priorities,
+		  other._priorities + FIELDS * stride(_graph->size()),
+		  _priorities);
 
 	return *this;
 }
 
 void Particle::randomize(void)
 {
-	// RNGs
-	std::default_random_engine re(std::time(NULL));
-	std::uniform_real_distribution<double> double_dist(-5, 5);
-	std::uniform_int_distribution<short> short_dist(0, 1);
-
-	auto real = [&re, &double_dist]() {
-		return double_dist(re);
+	// Uniform in [-5, 5) and fair coin flips from this particle's stream
+	auto real = [this]() {
+		return 10 * _rng.uniform() - 5;
 	};
-	auto integer = [&re, &short_dist]() {
-		return short_dist(re);
+	auto integer = [this]() {
+		return double(_rng() >> 63);
 	};
 
 	// Random position
-	std::generate(_priorities.begin(), _priorities.end(), real);
-	std::generate(_visiting.begin(), _visiting.end(), integer);
+	size_t n = _graph->size();
+	std::generate(_priorities, _priorities + n, real);
+	std::generate(_visiting, _visiting + n, integer);
 
 	// Random speed
-	std::generate(_priorities_speed.begin(), _priorities_speed.end(), real);
-	std::generate(_visiting_speed.begin(), _visiting_speed.end(), real);
+	std::generate(_priorities_speed, _priorities_speed + n, real);
+	std::generate(_visiting_speed, _visiting_speed + n, real);
 }
 
-void Particle::eval(void)
+bool Particle::eval(void)
 {
-	// Reset cost & reward
-	_cost = 0;
-	_reward = 0;
-
-	// Get the represented route
-	std::vector<unsigned int> R = std::move(route());
-
-	// Evaluate the route, ignorw double-used arcs rewards
-	bool double_use = false;
-	std::unordered_set<std::pair<unsigned int, unsigned int>, pair_hash> used;
-	for (size_t i = 0; i < R.size() - 1; i++) {
-		_cost += _graph.edge(R.at(i), R.at(i + 1)).cost();
-		if (!used.count(std::minmax(R.at(i), R.at(i + 1)))) {
-			_reward += _graph.edge(R.at(i), R.at(i + 1)).reward();
-			used.emplace(std::minmax(R.at(i), R.at(i + 1)));
-		} else {
-			double_use = true;
+	// Get the order of the represented route, in this thread's scratch
+	// space
+	Scratch &S = Scratch::local();
+	std::vector<unsigned int> &V = S.pending;
+	_order(V, _priorities, _visiting);
+
+	// Same order as last time, or as some particle before: no need to
+	// build the route again
+	Evaluation const &ev = *_evaluation;
+	FitnessCache *cache = ev.cache.get();
+	Fitness f;
+	bool built = false;
+	FitnessCache::Key key = FitnessCache::key(V);
+	if (key == _last_key) {
+		f = _last;
+		if (cache)
+			cache->repeat();
+	} else if (!cache || !cache->find(key, f)) {
+		std::vector<unsigned int> &R = S.route;
+		_build(R, V);
+		built = true;
+
+		// Evaluate the route, ignorw double-used arcs rewards
+		f = Fitness();
+		S.used.clear(R.size());
+		for (size_t i = 0; i < R.size() - 1; i++) {
+			Edge e = _graph->edge(R[i], R[i + 1]);
+			f.cost += e.cost();
+			if (S.used.insert(R[i], R[i + 1]))
+				f.reward += e.reward();
+			else
+				f.double_use = true;
 		}
+		if (cache)
+			cache->insert(key, f);
 	}
+	_last_key = key;
+	_last = f;
+
+	_cost = f.cost;
+	_reward = f.reward;
+	bool double_use = f.double_use;
 
 	// Penalize constraint violation
-	if (_cost < _Cmin || _cost > _Cmax)
-		_cost += 1 * _penalty;
+	if (_cost < ev.Cmin || _cost > ev.Cmax)
+		_cost += 1 * ev.penalty;
 	if (double_use)
-		_cost += 3 * _penalty;
+		_cost += 3 * ev.penalty;
 
 	// Check if it is better than the local best
-	if (std::isnan(_best_cost) || (_reward > _best_reward && _cost <= _Cmax)) {
+	bool improved = std::isnan(_best_cost)
+			|| (_reward > _best_reward && _cost <= ev.Cmax);
+	if (improved) {
+		if (built)
+			_best_route.assign(S.route.begin(), S.route.end());
+		else
+			_make_route(_best_route, _priorities, _visiting);
 		_best_cost = _cost;
 		_best_reward = _reward;
-		_best_priorities = _priorities;
-		_best_visiting = _visiting;
+		size_t n = _graph->size();
+		std::copy(_priorities, _priorities + n, _best_priorities);
+		std::copy(_visiting, _visiting + n, _best_visiting);
 	} else {
 		_times_no_improve++;
 	}
@@ -141,38 +239,162 @@ void Particle::eval(void)
 		randomize();
 	}
 
+	return improved;
 }
 
-void Particle::update_speed(Particle &best, double sf, double cf)
+void Particle::update(Particle const &best, double sf, double cf, double vmax)
 {
-	// Priorities speed
-	_priorities_speed += cf * (_best_priorities - _priorities);
-	_priorities_speed += sf * (best._best_priorities - _priorities);
+	size_t n = _graph->size();
+
+	// Sampling visiting[i] = 1 with probability sigma(speed) is the same
+	// as checking speed > logit(u) for an uniform u. Draw the thresholds
+	// first so the update below is plain arithmetic.
+	std::vector<double> &L = Scratch::local().noise;
+	L.resize(n);
+	_rng.uniform(L.data(), n);
+	for (size_t i = 0; i < n; i++)
+		L[i] = std::log(L[i]) - std::log1p(-L[i]);
+
+	// Velocity, clamp, position and sampling in a single pass
+	double const lim = vmax > 0 ? vmax : INFINITY;
+	double *__restrict p = _priorities;
+	double *__restrict v = _visiting;
+	double *__restrict ps = _priorities_speed;
+	double *__restrict vs = _visiting_speed;
+	double const *__restrict bp = _best_priorities;
+	double const *__restrict bv = _best_visiting;
+	double const *__restrict gp = best._best_priorities;
+	double const *__restrict gv = best._best_visiting;
+	double const *__restrict l = L.data();
+
+	#pragma omp simd
+	for (size_t i = 0; i < n; i++) {
+		double s = ps[i] + cf * (bp[i] - p[i]) + sf * (gp[i] - p[i]);
+		double t = vs[i] + cf * (bv[i] - v[i]) + sf * (gv[i] - v[i]);
+		s = s > lim ? lim : (s < -lim ? -lim : s);
+		t = t > lim ? lim : (t < -lim ? -lim : t);
+
+		ps[i] = s;
+		vs[i] = t;
+		p[i] += s;
+		v[i] = t > l[i] ? 1 : 0;
+	}
 
-	// Visiting speed
-	_visiting_speed += cf * std::vector<double>(_best_visiting.begin(), _best_visiting.end());
-	_visiting_speed -= cf * std::vector<double>(_visiting.begin(), _visiting.end());
-	_visiting_speed += sf * std::vector<double>(best._best_visiting.begin(), best._best_visiting.end());
-	_visiting_speed -= sf * std::vector<double>(_visiting.begin(), _visiting.end());
+	for (auto &blacklisted : _graph->blacklist())
+		_visiting[blacklisted] = 0;
 }
 
-void Particle::update_position(void)
+void Particle::adopt(double cost, unsigned int reward, double const *pri,
+		     double const *vis, std::vector<unsigned int> const &R)
 {
-	// Update position with speed
-	_priorities += _priorities_speed;
+	// Move to a position found elsewhere, at rest, and take it as the
+	// personal best too, route included
+	size_t n = _graph->size();
+	_cost = _best_cost = cost;
+	_reward = _best_reward = reward;
+	_times_no_improve = 0;
+	std::copy(pri, pri + n, _priorities);
+	std::copy(pri, pri + n, _best_priorities);
+	std::copy(vis, vis + n, _visiting);
+	std::copy(vis, vis + n, _best_visiting);
+	std::fill(_priorities_speed, _priorities_speed + n, 0);
+	std::fill(_visiting_speed, _visiting_speed + n, 0);
+	_best_route = R;
+}
 
-	// Use sigma function to update each coordinate of _visiting
-	// stochastically
-	std::random_device r;
-	std::default_random_engine e(r());
-	std::uniform_real_distribution<double> rand(0, 1);
-	for (size_t i = 0; i < _visiting.size(); i++)
-		if (rand(e) < 1 / (1 + exp(- _visiting_speed.at(i))))
-			_visiting.at(i) = true;
-		else
-			_visiting.at(i) = false;
-	for (auto &blacklisted : _graph.blacklist())
-		_visiting.at(blacklisted) = false;
+void Particle::fix(std::vector<unsigned int> const &R, double cost,
+		   unsigned int reward)
+{
+	// Keep a route found outside the decoder as the personal best, costed
+	// the way eval() would
+	_best_route = R;
+	_best_cost = cost;
+	if (cost < _evaluation->Cmin || cost > _evaluation->Cmax)
+		_best_cost += _evaluation->penalty;
+	_best_reward = reward;
+}
+
+void Particle::encode(std::vector<unsigned int> const &R, double cost,
+		      unsigned int reward)
+{
+	// Write the route into the personal best rows so the swarm is pulled
+	// towards it: its vertices are visited, by increasing priority in the
+	// order they first show up. The route itself is kept too, the decoder
+	// needn't rebuild it exactly.
+	size_t n = _graph->size();
+	std::vector<unsigned int> &first = Scratch::local().order;
+	first.clear();
+	std::fill(_best_visiting, _best_visiting + n, 0);
+	for (unsigned int v : R)
+		if (v != _graph->start() && !(_best_visiting[v] > 0)) {
+			_best_visiting[v] = 1;
+			first.push_back(v);
+		}
+
+	for (size_t k = 0; k < first.size(); k++)
+		_best_priorities[first[k]] = -5 + 10 * (k + 0.5) / first.size();
+
+	fix(R, cost, reward);
+}
+
+void Particle::start_at(std::vector<unsigned int> const &R, double cost,
+			unsigned int reward)
+{
+	// Start from a route found before: it becomes the personal best, and
+	// the position too, at rest
+	encode(R, cost, reward);
+	size_t n = _graph->size();
+	std::copy(_best_priorities, _best_priorities + n, _priorities);
+	std::copy(_best_visiting, _best_visiting + n, _visiting);
+	std::fill(_priorities_speed, _priorities_speed + n, 0);
+	std::fill(_visiting_speed, _visiting_speed + n, 0);
+	_cost = _best_cost;
+	_reward = _best_reward;
+	_times_no_improve = 0;
+}
+
+void Particle::perturb(unsigned int swaps)
+{
+	// Move off the position at random: swap the priorities of a few pairs
+	// of visited vertices, and set off at a random speed. The personal
+	// best stays where it was.
+	size_t n = _graph->size();
+	std::vector<unsigned int> &V = Scratch::local().order;
+	V.clear();
+	for (size_t v = 0; v < n; v++)
+		if (_visiting[v] > 0)
+			V.push_back(v);
+	for (unsigned int s = 0; V.size() > 1 && s < swaps; s++) {
+		unsigned int a = V[_rng() % V.size()];
+		unsigned int b = V[_rng() % V.size()];
+		std::swap(_priorities[a], _priorities[b]);
+	}
+
+	auto real = [this]() {
+		return 10 * _rng.uniform() - 5;
+	};
+	std::generate(_priorities_speed, _priorities_speed + n, real);
+	std::generate(_visiting_speed, _visiting_speed + n, real);
+}
+
+double const *Particle::best_priorities(void) const
+{
+	return _best_priorities;
+}
+
+double const *Particle::best_visiting(void) const
+{
+	return _best_visiting;
+}
+
+Graph const &Particle::graph(void) const
+{
+	return *_graph;
+}
+
+std::shared_ptr<Evaluation const> const &Particle::evaluation(void) const
+{
+	return _evaluation;
 }
 
 double Particle::cost(void) const
@@ -195,55 +417,72 @@ unsigned int Particle::best_reward(void) const
 	return _best_reward;
 }
 
-std::vector<unsigned int> Particle::_make_route(std::vector<double> const &pri, std::vector<bool> const &vis) const
+void Particle::_make_route(std::vector<unsigned int> &R, double const *pri, double const *vis) const
 {
-	// Route vector starting at start
-	std::vector<unsigned int> R;
-	R.reserve(_graph.size());
-	R.push_back(_graph.start());
+	// Buffers come from this thread's scratch space and only grow, the
+	// first decodes size them for good
+	std::vector<unsigned int> &V = Scratch::local().pending;
+	_order(V, pri, vis);
+	_build(R, V);
+}
 
+void Particle::_order(std::vector<unsigned int> &V, double const *pri, double const *vis) const
+{
 	// Comparison function to sort cities in order
 	auto cmp = [&pri](auto const a, auto const b) {
-		return pri.at(a) < pri.at(b);
+		return pri[a] < pri[b];
 	};
 
-	// Vector of vertices to visit in order
-	std::deque<unsigned int> V;
-	if (!_use_mst) {
-		for (size_t i = 0; i < pri.size(); i++)
-			if (vis.at(i) && i != _graph.start())
+	// Vertices to visit, in order. The decoded route depends on nothing
+	// else.
+	V.clear();
+	if (!_evaluation->use_mst) {
+		for (size_t i = 0; i < _graph->size(); i++)
+			if (vis[i] > 0 && i != _graph->start())
 				V.push_back(i);
 		std::sort(V.begin(), V.end(), cmp);
 	} else {
-		std::vector<unsigned int> Preorder = _graph.preorder(pri, vis);
-		for (auto &p : Preorder)
-			V.push_back(p);
+		_graph->preorder(V, pri, vis);
 	}
+}
+
+void Particle::_build(std::vector<unsigned int> &R, std::vector<unsigned int> &V) const
+{
+	// Route vector starting at start
+	R.clear();
+	R.reserve(2 * _graph->size());
+	R.push_back(_graph->start());
+
+	// Queue of vertices to visit in order, popped from head
+	V.reserve(4 * V.size());
+	size_t head = 0;
 
 	// Visit cities, add them in the best available position while route
 	// cost is less than Cmin
+	double const Cmin = _evaluation->Cmin;
+	double const Cmax = _evaluation->Cmax;
 	double cost = 0;
 	unsigned int max_tries = 3 * V.size();
 	unsigned int tries = 0;
-	while (!V.empty() && tries < max_tries && cost < (_Cmin + _Cmax) / 2) {
-		unsigned int new_vertex = V.front(); V.pop_front();
+	while (head < V.size() && tries < max_tries && cost < (Cmin + Cmax) / 2) {
+		unsigned int new_vertex = V[head++];
 		double candidate_cost = INFINITY;
 		// Try to insert before than pos 1
 		size_t candidate_position = 0;
 
 		// Try inserting in between
 		for (size_t i = 1; i < R.size(); i++) {
-			double e1 = _graph.edge(R.at(i - 1), new_vertex).cost();
-			double e2 = _graph.edge(new_vertex, R.at(i)).cost();
-			if (cost + e1 + e2 < candidate_cost && cost + e1 + e2 < _Cmax) {
+			double e1 = _graph->edge(R[i - 1], new_vertex).cost();
+			double e2 = _graph->edge(new_vertex, R[i]).cost();
+			if (cost + e1 + e2 < candidate_cost && cost + e1 + e2 < Cmax) {
 				candidate_cost = cost + e1 + e2;
 				candidate_position = i;
 			}
 		}
 		// Try inserting in the end
 		{
-			double e = _graph.edge(R.back(), new_vertex).cost();
-			if (cost + e < candidate_cost && cost + e < _Cmax) {
+			double e = _graph->edge(R.back(), new_vertex).cost();
+			if (cost + e < candidate_cost && cost + e < Cmax) {
 				candidate_cost = cost + e;
 				candidate_position = R.size();
 			}
@@ -264,10 +503,7 @@ std::vector<unsigned int> Particle::_make_route(std::vector<double> const &pri,
 	};
 
 	// Repair path until the end. Use Floyd Warshall's.
-	std::vector<unsigned int> path = _graph.best_path(R.back(), R.front());
-	R.insert(R.end(), path.begin(), path.end());
-
-	return R;
+	_graph->append_path(R, R.back(), R.front());
 }
 
 std::vector<unsigned int> Particle::route(void) const
@@ -276,63 +512,39 @@ std::vector<unsigned int> Particle::route(void) const
 	auto &pri = _priorities;
 	auto &vis = _visiting;
 
-	return std::move(_make_route(pri, vis));
-}
-
-std::vector<unsigned int> Particle::best_route(void) const
-{
-	// Reference priority and visiting
-	auto &pri = _best_priorities;
-	auto &vis = _best_visiting;
-
-	return std::move(_make_route(pri, vis));
+	std::vector<unsigned int> R;
+	_make_route(R, pri, vis);
+	return R;
 }
 
-void Particle::penalty(double p)
+std::vector<unsigned int> const &Particle::best_route(void) const
 {
-	_penalty = p;
+	return _best_route;
 }
 
-void Particle::Cmin(double cm)
+size_t Particle::stride(size_t size)
 {
-	_Cmin = cm;
+	size_t const line = CACHE_LINE / sizeof(double);
+	return (size + line - 1) / line * line;
 }
 
-void Particle::Cmax(double cm)
+bool Particle::better(Particle const &a, Particle const &b)
 {
-	_Cmax = cm;
+	return a._evaluation->better(a._best_cost, a._best_reward,
+				     b._best_cost, b._best_reward);
 }
 
-void Particle::use_mst(bool use_it)
+size_t Particle::best(Swarm const &S)
 {
-	_use_mst = use_it;
+	return best(S, 0, S.size());
 }
 
-Particle Particle::best(std::vector<Particle> &S)
+size_t Particle::best(Swarm const &S, size_t begin, size_t end)
 {
-	// Filter particles (indices)
-	std::vector<unsigned int> C;
-	C.reserve(S.size());
-
-	for (unsigned int i = 0; i < S.size(); i++)
-		if (S.at(i).best_cost() > _Cmin && S.at(i).best_cost() < _Cmax)
-			C.push_back(i);
-
-	// If no particle is good, return such with min cost (try to repair by
-	// cost first, then by reward, otherwise we will get only undfeasible
-	// solutions)
-	auto cmp1 = [](auto const &a, auto const &b) {
-		return a.best_cost() < b.best_cost();
-	};
-	if (C.empty())
-		return *std::min_element(S.begin(), S.end(), cmp1);
-
-	// If there are feasible solutions, sort them by reward
-	auto cmp2 = [&S](unsigned int const &a, unsigned int const &b) {
-		return S.at(a).best_reward() > S.at(b).best_reward();
-	};
-	std::stable_sort(C.begin(), C.end(), cmp2);
-
-	// Return the most rewarding feasible particle
-	return S.at(C.front());
+	// First of the best particles in [begin, end)
+	size_t best = begin;
+	for (size_t i = begin + 1; i < end; i++)
+		if (better(S[i], S[best]))
+			best = i;
+	return best;
 }
@@ -0,0 +1,172 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <utility>
+#include "path_cache.h"
+
+namespace {
+
+// Stamps are never reused, by another cache or after arcs change, so a
+// thread's handle can't be mistaken for a tree of the current arcs
+std::atomic<uint64_t> stamps(0);
+
+uint64_t next_stamp(void)
+{
+	return stamps.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+// Trees a thread looked up last, replaced in turn
+struct Handle {
+	uint64_t stamp = 0;
+	unsigned int root = 0;
+	std::shared_ptr<PathTree const> tree = {};
+};
+size_t const HANDLES = 8;
+thread_local std::array<Handle, HANDLES> handles;
+thread_local size_t victim = 0;
+
+}
+
+PathTree::PathTree(unsigned int size)
+	: cost(size, INFINITY)
+	, reward(size, 0)
+	, next(size, size)
+{}
+
+PathCache::PathCache(Adjacency const &A, size_t budget)
+	: _reverse(A.reversed())
+	, _capacity(std::max<size_t>(2, budget / tree_bytes(A.size())))
+	, _stamp(next_stamp())
+	, _lru()
+	, _trees()
+	, _m()
+{}
+
+PathCache::Tree PathCache::build(unsigned int root) const
+{
+	unsigned int const n = _reverse.size();
+	auto T = std::make_shared<PathTree>(n);
+
+	// Dijkstra from the root over reversed arcs: relaxing u -> v in the
+	// original graph means v is u's next hop
+	typedef std::pair<double, unsigned int> Item;
+	std::priority_queue< Item, std::vector<Item>, std::greater<Item> > Q;
+	T->cost[root] = 0;
+	Q.emplace(0, root);
+	while (!Q.empty()) {
+		auto [c, v] = Q.top(); Q.pop();
+		if (c > T->cost[v])
+			continue;
+		for (auto a = _reverse.begin(v); a != _reverse.end(v); a++) {
+			unsigned int u = a->to;
+			if (c + a->cost < T->cost[u]) {
+				T->cost[u] = c + a->cost;
+				T->reward[u] = T->reward[v] + a->reward;
+				T->next[u] = v;
+				Q.emplace(T->cost[u], u);
+			}
+		}
+	}
+
+	return T;
+}
+
+PathCache::Tree PathCache::tree(unsigned int root)
+{
+	assert(root < _reverse.size());
+	{
+		std::unique_lock<std::mutex> guard(_m);
+		auto it = _trees.find(root);
+		if (it != _trees.end()) {
+			_lru.splice(_lru.begin(), _lru, it->second.second);
+			return it->second.first;
+		}
+	}
+
+	// Build outside the lock. Two threads missing the same root may both
+	// build it, only the first one is kept.
+	Tree T = build(root);
+
+	std::unique_lock<std::mutex> guard(_m);
+	auto it = _trees.find(root);
+	if (it != _trees.end())
+		return it->second.first;
+
+	_lru.push_front(root);
+	_trees.emplace(root, std::make_pair(T, _lru.begin()));
+	if (_trees.size() > _capacity) {
+		_trees.erase(_lru.back());
+		_lru.pop_back();
+	}
+	return T;
+}
+
+PathTree const &PathCache::local(unsigned int root)
+{
+	// The tree stays alive in this thread's handles until they are
+	// replaced, that is until its next lookup of another tree misses
+	uint64_t const stamp = _stamp.load(std::memory_order_acquire);
+	for (Handle const &h : handles)
+		if (h.stamp == stamp && h.root == root)
+			return *h.tree;
+
+	Handle &h = handles[victim];
+	victim = (victim + 1) % HANDLES;
+	h.tree = tree(root);
+	h.stamp = stamp;
+	h.root = root;
+	return *h.tree;
+}
+
+void PathCache::update(unsigned int from, unsigned int to, double cost,
+			unsigned int reward)
+{
+	unsigned int k = _reverse.find(to, from);
+	if (k == _reverse.arcs())
+		return;
+
+	// Forget the trees the arc may change: those where from's path takes
+	// it, and those it now shortens. Trees handed out stay as they were.
+	std::unique_lock<std::mutex> guard(_m);
+	_reverse.set(k, cost, reward);
+	_stamp.store(next_stamp(), std::memory_order_release);
+	for (auto it = _trees.begin(); it != _trees.end(); ) {
+		PathTree const &T = *it->second.first;
+		if (T.next[from] == to || cost + T.cost[to] < T.cost[from]) {
+			_lru.erase(it->second.second);
+			it = _trees.erase(it);
+		} else {
+			it++;
+		}
+	}
+}
+
+size_t PathCache::capacity(void) const
+{
+	return _capacity;
+}
+
+size_t PathCache::tree_bytes(unsigned int size)
+{
+	return size * (sizeof(double) + 2 * sizeof(unsigned int));
+}
@@ -16,83 +16,427 @@
  */
 
 #include <algorithm>
-#include <future>
+#include <numeric>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <iostream>
 #include "overloads.h"
+#include "elite.h"
+#include "exchange.h"
+#include "fitness_cache.h"
+#include "incumbents.h"
+#include "local_search.h"
 #include "pso.h"
+#include "shared_best.h"
+#include "swarm.h"
 #include "threadpool.h"
 
+// Asynchronous PSO: every participant of the pool keeps claiming particles
+// and moving them against the latest published global best, without
+// waiting for the rest of the swarm. Stops after a number of evaluations.
+template <typename F>
+static Particle pso_async(ThreadPool &T, Swarm &swarm, F &&move,
+			  Options const &o, uint64_t evaluations)
+{
+	Graph const &G = swarm[0].graph();
+	auto const &ev = swarm[0].evaluation();
+	// Moves follow the first best until a snapshot is read, it may be
+	// too long to be published
+	Particle const first = swarm[Particle::best(swarm)];
+	SharedBest shared(first);
+	shared.offer(first);
+	if (o.incumbents)
+		o.incumbents->offer(first);
+
+	if (o.verbose)
+		std::cerr << "Random particles generated.\n"
+			  << "Optimizing asynchronously...\n";
+
+	// A particle is moved by one thread at a time, the others skip it
+	size_t const n = swarm.size();
+	std::unique_ptr<std::atomic<bool>[]> busy(new std::atomic<bool>[n]());
+	std::atomic<uint64_t> cursor(0);
+	std::atomic<uint64_t> done(0);
+	std::atomic<bool> stop(false);
+
+	auto const relaxed = std::memory_order_relaxed;
+	T.parallel_for(T.size() + 1, [&](size_t) {
+		Particle best(first);
+		uint64_t seen = 0;
+		while (!stop.load(relaxed)) {
+			size_t k = cursor.fetch_add(1, relaxed) % n;
+			if (busy[k].exchange(true, std::memory_order_acquire))
+				continue;
+			if (done.fetch_add(1, relaxed) >= evaluations
+			    || std::chrono::steady_clock::now() >= o.deadline) {
+				busy[k].store(false, std::memory_order_release);
+				stop.store(true, relaxed);
+				break;
+			}
+
+			// Publish the particle's personal best if it moved
+			Particle &p = swarm[k];
+			shared.read(best, seen);
+			if (move(p, best) && shared.offer(p) && o.incumbents)
+				o.incumbents->offer(p);
+			busy[k].store(false, std::memory_order_release);
+
+			if (o.optima && best.best_reward() == o.optima)
+				stop.store(true, relaxed);
+		}
+	}, 1);
+
+	if (o.verbose)
+		std::cerr << "Evaluations: "
+			  << std::min(done.load(), evaluations) << '\n';
 
-Particle pso(Graph &G, double Cmin, double Cmax, unsigned int max_cycles,
-	 unsigned int swarm_size, double social_factor, double cognitive_factor,
-	 bool use_mst, bool randomize, bool verbose, unsigned int optima,
-	 unsigned int threads)
+	// Routes too long for the snapshot were never published, the swarm's
+	// own best stands in when it is better
+	Particle best(G, ev);
+	uint64_t seen = 0;
+	size_t const top = Particle::best(swarm);
+	if (!shared.read(best, seen) || Particle::better(swarm[top], best))
+		best = swarm[top];
+	return best;
+}
+
+// Copy the top particles of every island over the worst ones of its
+// neighbours: the next island in a ring, or every other island
+static void migrate(Swarm &swarm, std::vector<size_t> const &first,
+		    unsigned int migrants, bool ring)
 {
-	if (verbose)
-		std::cerr << "Starting PSO.\nGenerating random particles...\n";
+	size_t const N = first.size() - 1;
+	auto cmp = [&swarm](size_t a, size_t b) {
+		return Particle::better(swarm[a], swarm[b]);
+	};
 
-	// Set evaluation function penalization, Cmax, Cmin, and if it should
-	// use MST
-	Particle::penalty(Cmax);
-	Particle::Cmin(Cmin);
-	Particle::Cmax(Cmax);
-	Particle::use_mst(use_mst);
+	// Rank each island's particles. Emigrants and the particles they
+	// replace never overlap, so migration can copy in place.
+	std::vector< std::vector<size_t> > ranks(N);
+	size_t M = migrants;
+	for (size_t j = 0; j < N; j++) {
+		ranks[j].resize(first[j + 1] - first[j]);
+		std::iota(ranks[j].begin(), ranks[j].end(), first[j]);
+		std::stable_sort(ranks[j].begin(), ranks[j].end(), cmp);
+		M = std::min(M, ranks[j].size() / 2);
+	}
 
-	// Generate and randomize swarm
-	std::vector<Particle> swarm(swarm_size, Particle(G));
-	for (Particle &p : swarm) {
-		p.randomize();
-		p.eval();
+	for (size_t j = 0; j < N; j++) {
+		// Candidates are the emigrants of the islands sending to j
+		std::vector<size_t> in;
+		for (size_t from = 0; from < N; from++)
+			if (from != j && (!ring || (from + 1) % N == j))
+				in.insert(in.end(), ranks[from].begin(),
+					  ranks[from].begin() + M);
+		std::stable_sort(in.begin(), in.end(), cmp);
+
+		for (size_t m = 0; m < M; m++)
+			swarm[ranks[j][ranks[j].size() - 1 - m]] = swarm[in[m]];
 	}
+}
+
+// Publish this process' best and take in those of the processes sending to
+// it, over the worst particles of the swarm
+static void trade(Swarm &swarm, Exchange &E, Particle const &best, bool ring)
+{
+	E.publish(best);
+
+	std::vector<size_t> rank(swarm.size());
+	std::iota(rank.begin(), rank.end(), 0);
+	std::stable_sort(rank.begin(), rank.end(),
+			 [&swarm](size_t a, size_t b) {
+		return Particle::better(swarm[a], swarm[b]);
+	});
+
+	size_t worst = rank.size();
+	unsigned int const P = E.slots();
+	for (unsigned int from = 0; from < P && worst > 1; from++)
+		if (from != E.self() && (!ring || (from + 1) % P == E.self()))
+			if (E.fetch(from, swarm[rank[worst - 1]]))
+				worst--;
+}
+
+// Memetic step: polish the elite personal bests with a few local search
+// moves each, and write the improved routes back into their rows so the
+// swarm is pulled towards them
+static void refine(ThreadPool &T, Swarm &swarm, Polish const &P,
+		   std::vector<LocalSearch> &S, std::vector<size_t> &rank,
+		   Elite *elite)
+{
+	size_t const E = S.size();
+	rank.resize(swarm.size());
+	std::iota(rank.begin(), rank.end(), 0);
+	std::partial_sort(rank.begin(), rank.begin() + E, rank.end(),
+			  [&swarm](size_t a, size_t b) {
+		return Particle::better(swarm[a], swarm[b]);
+	});
+
+	T.parallel_for(E, [&](size_t k) {
+		Particle &p = swarm[rank[k]];
+		if (S[k].load(p.best_route()) && S[k].run(P.elite_moves)) {
+			p.encode(S[k].route(), S[k].cost(), S[k].reward());
+			if (elite)
+				elite->offer(p);
+		}
+	}, 1);
+}
+
+// Bulk-synchronous PSO: every iteration moves the whole swarm, then picks
+// the best of each island
+template <typename F>
+static Particle pso_sync(ThreadPool &T, Swarm &swarm, F &&move,
+			 Options const &o, double Cmin, double Cmax,
+			 Elite *elite)
+{
+	Graph const &G = swarm[0].graph();
+
+	// Searches for the memetic step, reused every iteration
+	LocalSearch const empty(G, Cmin, Cmax);
+	std::vector<LocalSearch> searches(std::min<size_t>(o.polish.elite,
+							   swarm.size()), empty);
+	std::vector<size_t> rank;
+
+	// Islands are contiguous ranges of the swarm, each one following its
+	// own best. A single island is the classic PSO.
+	Islands const &I = o.islands;
+	size_t const N = std::max<size_t>(1, std::min<size_t>(I.count,
+							      swarm.size()));
+	std::vector<size_t> first(N + 1);
+	for (size_t j = 0; j <= N; j++)
+		first[j] = j * swarm.size() / N;
+	std::vector<size_t> island(swarm.size());
+	for (size_t j = 0; j < N; j++)
+		std::fill(island.begin() + first[j],
+			  island.begin() + first[j + 1], j);
 
 	// Select best particle so far, maybe we already found a good one!
-	Particle best = Particle::best(swarm);
+	// Only snapshots are kept: particles keep moving while the others
+	// read them. They are taken again only when the best changed: the
+	// same particle with the same cost and reward has the same personal
+	// best.
+	auto const &ev = swarm[0].evaluation();
+	std::vector<Particle> bests(N, Particle(G, ev));
+	std::vector<size_t> from(N, swarm.size());
+	Particle best(G, ev);
+	size_t best_from = swarm.size();
+	auto same = [](Particle const &a, Particle const &b) {
+		return a.best_reward() == b.best_reward()
+		    && !(a.best_cost() < b.best_cost())
+		    && !(b.best_cost() < a.best_cost());
+	};
+	auto select = [&]() {
+		size_t top = 0;
+		for (size_t j = 0; j < N; j++) {
+			size_t k = Particle::best(swarm, first[j], first[j + 1]);
+			if (k != from[j] || !same(swarm[k], bests[j])) {
+				bests[j] = swarm[k];
+				from[j] = k;
+			}
+			if (Particle::better(bests[j], bests[top]))
+				top = j;
+		}
+		if (from[top] != best_from || !same(bests[top], best)) {
+			best = bests[top];
+			best_from = from[top];
+			if (o.incumbents)
+				o.incumbents->offer(best);
+		}
+	};
+	select();
 
-	if (verbose)
+	if (o.verbose)
 		std::cerr << "Random particles generated.\n"
 			  << "Starting optimization...\n";
 
-	// Create a threadpool to process particles
-	ThreadPool T(threads);
-
 	// Iterate max_cycles, if optima is set, iterate until optima is found
-	for (unsigned int i = 0; optima || (i < max_cycles); i++) {
-		if (optima && best.best_reward() == optima) {
+	for (unsigned int i = 0; o.optima || (i < o.max_cycles); i++) {
+		if (o.optima && best.best_reward() == o.optima) {
 			std::cerr << "Iterations: " << i << '\n';
 			break;
 		}
-		if (verbose && (max_cycles <= 100 || i % (max_cycles / 100) == 0)
-		    && i != max_cycles)
+		if (std::chrono::steady_clock::now() >= o.deadline) {
+			if (o.verbose)
+				std::cerr << "Time limit reached, iterations: "
+					  << i << '\n';
+			break;
+		}
+		if (o.verbose && i != o.max_cycles
+		    && (o.max_cycles <= 100 || i % (o.max_cycles / 100) == 0))
 			std::cerr << "Optimizing "
-				  << int(100.0 * i / max_cycles)
+				  << int(100.0 * i / o.max_cycles)
 				  << "%...\n";
 
-		// Create a job "queue" to process particles
-		std::vector< std::future<void> > jobs;
-		for (auto &p : swarm) {
-			jobs.emplace_back(T.enqueue([&] {
-				if (!randomize) {
-					p.update_speed(best, social_factor, cognitive_factor);
-					p.update_position();
-				} else {
-					p.randomize();
-				}
-				p.eval();
-			}));
-		}
+		// Move every particle, the pool's workers stay alive between
+		// iterations and meet at a barrier when all are done
+		T.parallel_for(swarm.size(), [&](size_t k) {
+			move(swarm[k], bests[island[k]]);
+		});
 
-		// Wait for all particles to be ready
-		for (auto &job : jobs)
-			job.wait();
+		// Exchange the best particles between islands, and with the
+		// other processes
+		if (I.interval && (i + 1) % I.interval == 0) {
+			if (N > 1)
+				migrate(swarm, first, I.migrants, I.ring);
+			if (I.remote)
+				trade(swarm, *I.remote, best, I.ring);
+		}
+		if (!searches.empty())
+			refine(T, swarm, o.polish, searches, rank, elite);
 
-		// Update best particle
-		best = Particle::best(swarm);
+		// Update best particles
+		select();
 	}
 
-	if (verbose)
+	if (o.verbose)
 		std::cerr << "Optimizing: 100%!\n";
 
-	// Return best particle
 	return best;
 }
 
+void polish(Particle &best, std::vector<Particle const *> const &C,
+	    double Cmin, double Cmax, Polish const &P, ThreadPool &T)
+{
+	// One search per candidate route, routes that use an arc twice or
+	// miss one are left alone
+	LocalSearch const empty(best.graph(), Cmin, Cmax);
+	std::vector<LocalSearch> S(C.size(), empty);
+	std::vector<char> loaded(C.size(), false);
+	T.parallel_for(C.size(), [&](size_t k) {
+		loaded[k] = S[k].load(C[k]->best_route());
+		if (loaded[k])
+			S[k].run(P.moves);
+	}, 1);
+
+	LocalSearch const *top = NULL;
+	for (size_t k = 0; k < C.size(); k++)
+		if (loaded[k] && (!top || S[k].better(*top)))
+			top = &S[k];
+	if (!top)
+		return;
+
+	Particle polished(best);
+	polished.fix(top->route(), top->cost(), top->reward());
+	if (Particle::better(polished, best))
+		best = polished;
+}
+
+Particle pso(Graph const &G, double Cmin, double Cmax, Options const &o,
+	     ThreadPool &T, Elite *elite)
+{
+	if (o.verbose)
+		std::cerr << "Starting PSO.\nGenerating random particles...\n";
+
+	// Set evaluation function penalization, Cmax, Cmin, if it should use
+	// MST, and the cache of evaluated orders shared by the whole swarm
+	auto ev = std::make_shared<Evaluation const>(Cmin, Cmax, o.mst,
+						     o.fitness_cache);
+
+	// Routes to start from that fit this graph, costed with its arcs.
+	// They are spread evenly over the swarm so islands get their share.
+	// Every other particle of the rest starts at a shuffled copy of the
+	// nearest one, the others at random.
+	Swarm swarm(G, ev, o.swarm_size, o.seed);
+	std::vector<LocalSearch> warm;
+	for (auto const &R : o.warm_start) {
+		if (warm.size() == swarm.size())
+			break;
+		auto outside = [&G](unsigned int v) { return v >= G.size(); };
+		LocalSearch S(G, Cmin, Cmax);
+		if (!R.empty() && R.front() == G.start()
+		    && std::none_of(R.begin(), R.end(), outside) && S.load(R))
+			warm.push_back(S);
+	}
+	std::vector<size_t> at(swarm.size(), warm.size());
+	std::vector<bool> exact(swarm.size(), false);
+	for (size_t k = 0; !warm.empty() && k < swarm.size(); k += 2)
+		at[k] = k * warm.size() / swarm.size();
+	for (size_t i = 0; i < warm.size(); i++) {
+		at[i * swarm.size() / warm.size()] = i;
+		exact[i * swarm.size() / warm.size()] = true;
+	}
+	if (o.verbose && !o.warm_start.empty())
+		std::cerr << "Warm start: " << warm.size() << " of "
+			  << o.warm_start.size() << " routes\n";
+
+	// Generate and randomize swarm
+	T.parallel_for(swarm.size(), [&](size_t k) {
+		swarm[k].randomize();
+		if (at[k] < warm.size()) {
+			LocalSearch const &S = warm[at[k]];
+			swarm[k].start_at(S.route(), S.cost(), S.reward());
+			if (!exact[k])
+				swarm[k].perturb(S.route().size() / 4 + 1);
+		}
+		swarm[k].eval();
+		if (elite)
+			elite->offer(swarm[k]);
+	});
+
+	// Move a particle towards (a snapshot of) the global best, tell if
+	// its personal best improved
+	auto move = [&](Particle &p, Particle const &best) {
+		if (!o.random)
+			p.update(best, o.social_factor, o.cognitive_factor,
+				 o.max_velocity);
+		else
+			p.randomize();
+		bool improved = p.eval();
+		if (improved && elite)
+			elite->offer(p);
+		return improved;
+	};
+
+	Particle best = o.async
+		? pso_async(T, swarm, move, o, o.evaluations
+			    ? o.evaluations
+			    : uint64_t(o.max_cycles) * o.swarm_size)
+		: pso_sync(T, swarm, move, o, Cmin, Cmax, elite);
+
+	if (o.verbose && ev->cache) {
+		FitnessCache const &cache = *ev->cache;
+		uint64_t hits = cache.hits(), misses = cache.misses();
+		uint64_t repeats = cache.repeats();
+		uint64_t total = hits + misses + repeats;
+		std::cerr << "Fitness cache: " << repeats << " repeated, "
+			  << hits << " hit, " << misses << " missed out of "
+			  << total << " evaluations ("
+			  << (total ? 100.0 * (hits + repeats) / total : 0)
+			  << "% not decoded)\n";
+	}
+
+	// The best may have come from another process, without passing
+	// through move
+	if (elite)
+		elite->offer(best);
+
+	// Polish the best route, and the next best personal bests, if there
+	// is still time
+	if (o.polish.top && std::chrono::steady_clock::now() < o.deadline) {
+		std::vector<size_t> rank(swarm.size());
+		std::iota(rank.begin(), rank.end(), 0);
+		std::stable_sort(rank.begin(), rank.end(),
+				 [&swarm](size_t a, size_t b) {
+			return Particle::better(swarm[a], swarm[b]);
+		});
+
+		std::vector<Particle const *> C(1, &best);
+		for (size_t k = 1; k < o.polish.top && k < rank.size(); k++)
+			C.push_back(&swarm[rank[k]]);
+
+		unsigned int before = best.best_reward();
+		polish(best, C, Cmin, Cmax, o.polish, T);
+		if (o.incumbents)
+			o.incumbents->offer(best);
+		if (elite)
+			elite->offer(best);
+		if (o.verbose)
+			std::cerr << "Local search: reward " << before
+				  << " -> " << best.best_reward() << '\n';
+	}
+
+	// Return best particle
+	return best;
+}
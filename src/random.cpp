@@ -0,0 +1,70 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "random.h"
+
+static uint64_t splitmix64(uint64_t &x)
+{
+	uint64_t z = (x += UINT64_C(0x9e3779b97f4a7c15));
+	z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+	return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+Random::Random(uint64_t seed, uint64_t stream)
+	: _s()
+{
+	// Mix the stream into the seed first, so nearby streams of the same
+	// seed don't start from related states
+	uint64_t x = seed;
+	x = splitmix64(x) ^ stream;
+	for (auto &s : _s)
+		s = splitmix64(x);
+}
+
+uint64_t Random::operator()(void)
+{
+	uint64_t const result = rotl(_s[1] * 5, 7) * 9;
+	uint64_t const t = _s[1] << 17;
+
+	_s[2] ^= _s[0];
+	_s[3] ^= _s[1];
+	_s[1] ^= _s[2];
+	_s[0] ^= _s[3];
+	_s[2] ^= t;
+	_s[3] = rotl(_s[3], 45);
+
+	return result;
+}
+
+double Random::uniform(void)
+{
+	// Top 53 bits as a double in [0, 1)
+	return double((*this)() >> 11) / 9007199254740992.0;
+}
+
+void Random::uniform(double *out, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		out[i] = uniform();
+}
@@ -0,0 +1,75 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "scratch.h"
+
+ArcSet::ArcSet(void)
+	: _keys()
+	, _stamps()
+	, _epoch(0)
+{}
+
+void ArcSet::clear(size_t expected)
+{
+	// Keep the load factor under 1/2
+	size_t capacity = 16;
+	while (capacity < 2 * expected)
+		capacity *= 2;
+
+	if (capacity > _keys.size()) {
+		_keys.assign(capacity, 0);
+		_stamps.assign(capacity, 0);
+		_epoch = 0;
+	}
+
+	// On wrap around old stamps could look current, wipe them
+	if (++_epoch == 0) {
+		std::fill(_stamps.begin(), _stamps.end(), 0);
+		_epoch = 1;
+	}
+}
+
+bool ArcSet::insert(unsigned int a, unsigned int b)
+{
+	// Returns false if the arc (either way) was already there
+	uint64_t key = uint64_t(std::min(a, b)) << 32 | std::max(a, b);
+	size_t mask = _keys.size() - 1;
+	size_t i = (key * UINT64_C(0x9E3779B97F4A7C15)) >> 32 & mask;
+	while (_stamps[i] == _epoch) {
+		if (_keys[i] == key)
+			return false;
+		i = (i + 1) & mask;
+	}
+	_keys[i] = key;
+	_stamps[i] = _epoch;
+	return true;
+}
+
+Scratch::Scratch(void)
+	: route()
+	, pending()
+	, order()
+	, noise()
+	, used()
+{}
+
+Scratch &Scratch::local(void)
+{
+	static thread_local Scratch S;
+	return S;
+}
@@ -0,0 +1,98 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include "shared_best.h"
+
+SharedBest::SharedBest(Particle const &like)
+	: _size(like.graph().size())
+	, _capacity(like.graph().adjacency().arcs() + 1)
+	, _rows(2 * _size)
+	, _route(_capacity)
+	, _cost(0)
+	, _reward(0)
+	, _length(0)
+	, _version(0)
+	, _write()
+{
+	// Only sized after the particle given, nothing is published yet
+}
+
+bool SharedBest::offer(Particle const &p)
+{
+	std::lock_guard<std::mutex> guard(_write);
+
+	// Nothing was published yet, or p beats the snapshot. Routes that
+	// don't fit are never published.
+	auto const &R = p.best_route();
+	uint64_t v = _version.load(std::memory_order_relaxed);
+	if (v && !p.evaluation()->better(p.best_cost(), p.best_reward(),
+					 _cost, _reward))
+		return false;
+	if (R.empty() || R.size() > _capacity)
+		return false;
+
+	_version.store(v + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	_cost = p.best_cost();
+	_reward = p.best_reward();
+	_length = R.size();
+	std::memcpy(_rows.data(), p.best_priorities(), _size * sizeof(double));
+	std::memcpy(_rows.data() + _size, p.best_visiting(),
+		    _size * sizeof(double));
+	std::memcpy(_route.data(), R.data(), R.size() * sizeof(unsigned int));
+	_version.store(v + 2, std::memory_order_release);
+	return true;
+}
+
+bool SharedBest::read(Particle &p, uint64_t &seen) const
+{
+	// Copy only if something newer than the caller's copy is out. The
+	// snapshot goes through scratch first, p takes it once it is whole.
+	static thread_local std::vector<double> rows;
+	static thread_local std::vector<unsigned int> R;
+	rows.resize(2 * _size);
+	double cost;
+	unsigned int reward;
+	for ( ;; ) {
+		uint64_t v = _version.load(std::memory_order_acquire);
+		if (v == seen)
+			return false;
+		if (v & 1) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		cost = _cost;
+		reward = _reward;
+		R.assign(_route.data(),
+			 _route.data() + std::min(_length, _capacity));
+		std::memcpy(rows.data(), _rows.data(),
+			    2 * _size * sizeof(double));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (_version.load(std::memory_order_relaxed) == v) {
+			seen = v;
+			break;
+		}
+	}
+
+	p.adopt(cost, reward, rows.data(), rows.data() + _size, R);
+	return true;
+}
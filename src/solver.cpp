@@ -0,0 +1,53 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <utility>
+#include "particle.h"
+#include "solver.h"
+
+Solver::Solver(Graph &&G, unsigned int threads, bool pin)
+	: Solver(std::move(G), std::make_shared<ThreadPool>(threads, pin))
+{}
+
+Solver::Solver(Graph &&G, std::shared_ptr<ThreadPool> const &pool)
+	: Solver(std::make_shared<Graph const>(std::move(G)), pool)
+{}
+
+Solver::Solver(std::shared_ptr<Graph const> const &G,
+	       std::shared_ptr<ThreadPool> const &pool)
+	: _graph(G)
+	, _pool(pool)
+{}
+
+Graph const &Solver::graph(void) const
+{
+	return *_graph;
+}
+
+Solver Solver::rooted(unsigned int start) const
+{
+	return Solver(Graph::rooted(_graph, start), _pool);
+}
+
+std::vector<Solution> Solver::solve(double Cmin, double Cmax,
+				    Options const &o) const
+{
+	// Every solve has its own swarm, evaluation settings and elite
+	Elite elite(o.top_k > 1 ? o.top_k : 0);
+	Particle best = pso(*_graph, Cmin, Cmax, o, *_pool, &elite);
+	return elite.top(best, o.top_k);
+}
@@ -0,0 +1,67 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "swarm.h"
+
+Swarm::Swarm(Graph const &G, std::shared_ptr<Evaluation const> const &ev,
+	     unsigned int size, uint64_t seed)
+	: _storage(size_t(size) * Particle::FIELDS * Particle::stride(G.size()), 0)
+	, _particles()
+{
+	// Particles keep pointers into the storage, never let them move. Each
+	// one gets its own random stream, numbered by its position.
+	size_t block = Particle::FIELDS * Particle::stride(G.size());
+	_particles.reserve(size);
+	for (size_t i = 0; i < size; i++)
+		_particles.emplace_back(G, ev, _storage.data() + i * block,
+					Random(seed, i));
+}
+
+size_t Swarm::size(void) const
+{
+	return _particles.size();
+}
+
+Particle &Swarm::operator[](size_t i)
+{
+	return _particles[i];
+}
+
+Particle const &Swarm::operator[](size_t i) const
+{
+	return _particles[i];
+}
+
+std::vector<Particle>::iterator Swarm::begin(void)
+{
+	return _particles.begin();
+}
+
+std::vector<Particle>::iterator Swarm::end(void)
+{
+	return _particles.end();
+}
+
+std::vector<Particle>::const_iterator Swarm::begin(void) const
+{
+	return _particles.begin();
+}
+
+std::vector<Particle>::const_iterator Swarm::end(void) const
+{
+	return _particles.end();
+}
@@ -0,0 +1,178 @@
+/*
+ * OOPS - Particle Swarm Optimization for the Arc Orienteering Problem
+ * Copyright (C) 2018	Manuel Weitzman
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "threadpool.h"
+
+// Pool the current thread is working for, if any
+static thread_local ThreadPool const *inside = NULL;
+
+ThreadPool::ThreadPool(unsigned int threads, bool pin)
+	: _W()
+	, _T()
+	, _m()
+	, _c()
+	, _r(false)
+	, _turn()
+	, _ranges()
+	, _body(NULL)
+	, _n(0)
+	, _grain(1)
+	, _generation(0)
+	, _running(0)
+	, _done()
+{
+	unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+	if (!threads)
+		threads = cores;
+	_ranges.reset(new Range[threads + 1]);
+
+	// Create workers, each try to get a job and do it while there are jobs
+	// to do. A new parallel_for generation takes precedence over tasks.
+	for (unsigned int i = 0; i < threads; i++) _W.emplace_back([this, i] {
+		inside = this;
+		unsigned long seen = 0;
+		for ( ;; ) {
+			std::packaged_task<void()> t;
+			{
+				std::unique_lock<std::mutex> guard(_m);
+				_c.wait(guard, [this, seen] {
+					return _r || !_T.empty()
+					       || _generation != seen;
+				});
+
+				if (_generation != seen) {
+					seen = _generation;
+				} else if (_r && _T.empty()) {
+					return;
+				} else {
+					t = std::move(_T.front()); _T.pop();
+				}
+			}
+			if (t.valid()) {
+				t();
+				continue;
+			}
+
+			// Last one out of the generation wakes the caller
+			_work(i + 1);
+			if (_running.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				std::lock_guard<std::mutex> guard(_m);
+				_done.notify_one();
+			}
+		}
+	});
+
+#ifdef __linux__
+	// Pin workers round robin over the cores
+	for (unsigned int i = 0; pin && i < threads; i++) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(i % cores, &set);
+		pthread_setaffinity_np(_W[i].native_handle(), sizeof(set), &set);
+	}
+#else
+	(void)pin;
+#endif
+}
+
+ThreadPool::~ThreadPool(void)
+{
+	// Before destruction, allow al jobs to finish
+	{
+		std::unique_lock<std::mutex> guard(_m);
+		_r = true;
+	}
+	_c.notify_all();
+
+	// Wait for all jobs
+	for (auto &w : _W)
+		w.join();
+}
+
+size_t ThreadPool::size(void) const
+{
+	return _W.size();
+}
+
+void ThreadPool::_work(size_t self)
+{
+	// Own share first, then steal what is left of the others'
+	size_t const P = _W.size() + 1;
+	for (size_t k = 0; k < P; k++) {
+		Range &r = _ranges[(self + k) % P];
+		for ( ;; ) {
+			size_t c = r.next.fetch_add(1, std::memory_order_relaxed);
+			if (c >= r.end)
+				break;
+			size_t lo = c * _grain;
+			(*_body)(lo, std::min(lo + _grain, _n));
+		}
+	}
+}
+
+void ThreadPool::_for(size_t n, size_t grain,
+		      std::function<void(size_t, size_t)> const &body)
+{
+	if (!n)
+		return;
+
+	// Nested in this pool's own work, every participant is busy already
+	if (inside == this) {
+		body(0, n);
+		return;
+	}
+
+	std::lock_guard<std::mutex> turn(_turn);
+
+	// A few chunks per participant leave room for stealing
+	size_t const P = _W.size() + 1;
+	if (!grain)
+		grain = std::max<size_t>(1, n / (4 * P));
+	size_t const chunks = (n + grain - 1) / grain;
+
+	{
+		std::lock_guard<std::mutex> guard(_m);
+		for (size_t p = 0; p < P; p++) {
+			_ranges[p].next.store(p * chunks / P,
+					      std::memory_order_relaxed);
+			_ranges[p].end = (p + 1) * chunks / P;
+		}
+		_body = &body;
+		_n = n;
+		_grain = grain;
+		_running.store(_W.size(), std::memory_order_relaxed);
+		_generation++;
+	}
+	_c.notify_all();
+
+	// Help, then wait at the barrier for every worker to leave
+	ThreadPool const *outer = inside;
+	inside = this;
+	_work(0);
+	inside = outer;
+	std::unique_lock<std::mutex> guard(_m);
+	_done.wait(guard, [this] {
+		return _running.load(std::memory_order_acquire) == 0;
+	});
+	_body = NULL;
+}